@@ -18,6 +18,11 @@
 
     $[State Machine]
     sequence[BT]
+
+  Dynamic parameters:
+    $n:   the field gets a copy of argument n
+    &$n:  the field is a pointer to argument n, which lives as long as the prepared tree
+    $n&&: argument n is moved into the field. only the first node entering with it gets the value
 */
 
 namespace TBT::Compiler {
@@ -35,6 +40,12 @@ namespace TBT::Compiler {
   constexpr uint8_t pt_float = 0b00000100;  // float type
   constexpr uint8_t pt_dyn   = 0b00001000;  // dynamic type
 
+  // how a dynamic parameter is bound. stored in the upper bits of its index
+  constexpr uint32_t bind_copy = 0;
+  constexpr uint32_t bind_ref  = 1u << 31;  // &$n
+  constexpr uint32_t bind_move = 1u << 30;  // $n&&
+  constexpr uint32_t bind_mask = bind_ref | bind_move;
+
   template <typename Variant>
   consteval auto variant_type_index_name_pairs() {
     using V            = std::remove_cvref_t<Variant>;
@@ -45,6 +56,17 @@ namespace TBT::Compiler {
     }(std::make_index_sequence<N>{});
   }  // variant_type_index_name_pairs
 
+  template <typename Variant>
+  consteval auto variant_type_layouts() {
+    using V            = std::remove_cvref_t<Variant>;
+    constexpr size_t N = std::variant_size_v<V>;
+    return []<size_t... I>(std::index_sequence<I...>) consteval {
+      using tuple_t = std::pair<size_t, size_t>;
+      return std::array<tuple_t, N>{
+          {tuple_t{sizeof(std::variant_alternative_t<I, V>), alignof(std::variant_alternative_t<I, V>)}...}};
+    }(std::make_index_sequence<N>{});
+  }  // variant_type_layouts
+
   template <class T>
   consteval size_t real_size() {
     using TT = std::decay_t<T>;
@@ -56,6 +78,9 @@ namespace TBT::Compiler {
       return sizeof(int32_t);
     } else if constexpr (std::is_arithmetic_v<T>) {
       return sizeof(TT);
+    } else if constexpr (std::has_unique_object_representations_v<TT>) {
+      // no padding. stored with its native layout
+      return sizeof(TT);
     } else {
       T dummy;
       auto tie         = glz::to_tie(dummy);
@@ -86,6 +111,8 @@ namespace TBT::Compiler {
       return std::bit_cast<std::array<uint8_t, M>>((_in ? int32_t(1) : int32_t(0)));
     } else if constexpr (std::is_arithmetic_v<TT>) {
       return std::bit_cast<std::array<uint8_t, M>>(_in);
+    } else if constexpr (std::has_unique_object_representations_v<TT>) {
+      return std::bit_cast<std::array<uint8_t, M>>(_in);
     } else {
       constexpr auto N = glz::reflect<TT>::size;
       auto tie         = glz::to_tie(_in);
@@ -119,6 +146,8 @@ namespace TBT::Compiler {
       return (std::bit_cast<int32_t>(_in) > 0);
     } else if constexpr (std::is_arithmetic_v<TT>) {
       return std::bit_cast<TT>(_in);
+    } else if constexpr (std::has_unique_object_representations_v<TT>) {
+      return std::bit_cast<TT>(_in);
     } else {
       constexpr auto M = glz::reflect<TT>::size;
       T out;
@@ -144,10 +173,14 @@ namespace TBT::Compiler {
     }
   };  // deserialize
 
+  /*
+    The structs below are stored in the tree with their native layout. They are free of padding bytes,
+    so they can be copied in and out of the tree with a single memcpy and bit_cast in constant expressions.
+  */
+
   struct Composite {
-    uintptr_t co_    = 0;
-    uintptr_t ptr_   = 0;
-    int16_t cur_idx_ = 0;
+    uintptr_t co_  = 0;
+    uintptr_t ptr_ = 0;
   };  // Composite
 
   struct Result {
@@ -161,29 +194,34 @@ namespace TBT::Compiler {
     uint32_t node_count_        = 0;
     uint32_t ptr_               = 0;
 
-    uint16_t children_count_    = 0;
+    uint32_t children_count_    = 0;
     uint32_t first_node_offset_ = 0;
 
     Result last_result_;
 
-    uint16_t child_idx_ = 0;
-    // Result last_result_;
+    // inline storage for the state of the active task. only one task of a tree is alive at any time
+    uint32_t slot_offset_ = 0;
+    uint32_t slot_size_   = 0;
+    uint32_t slot_align_  = 0;
   };  // Header
 
   struct NodeHeader {
     // constexpr static size_t real_size_ = real_size<NodeHeader>();
-    int16_t type_idx_         = 0;
+    int32_t type_idx_         = 0;
     uint32_t parent_          = 0;
 
     uint32_t children_offset_ = 0;
-    uint16_t children_count_  = 0;
+    uint32_t children_count_  = 0;
 
     uint32_t params_offset_   = 0;
-    uint16_t params_count_    = 0;
+    uint32_t params_count_    = 0;
 
     uint32_t comp_offset_     = 0;
 
     uint32_t node_size_       = 0;
+
+    // the node after the subtree of this one. 0 if it is the last one of the tree
+    uint32_t next_            = 0;
   };  // NodeHeader
 
   namespace RealSize {
@@ -191,8 +229,16 @@ namespace TBT::Compiler {
     constexpr size_t result      = real_size<Result>();
     constexpr size_t header      = real_size<Header>();
     constexpr size_t node_header = real_size<NodeHeader>();
+
+    // every node starts at a multiple of this offset
+    constexpr size_t node_align  = std::max(alignof(NodeHeader), alignof(Composite));
+
+    static_assert(composite == sizeof(Composite) && header == sizeof(Header) && node_header == sizeof(NodeHeader),
+                  "tree structs must be free of padding");
   }  // namespace RealSize
 
+  constexpr size_t align_up(const size_t _val, const size_t _align) { return (_val + _align - 1) / _align * _align; }
+
   inline constexpr std::array<uint8_t, RealSize::composite> serialize_composite(const Composite& _in) {
     return serialize<Composite, RealSize::composite>(_in);
   }  // serialize_composite
@@ -227,67 +273,119 @@ namespace TBT::Compiler {
 
   //--------------------------------------------------
 
+  // at runtime the structs are copied with a single memcpy. the byte-wise path is only taken in constant expressions
+
   inline constexpr Header read_global_node_header(std::span<const uint8_t> _tree) {
-    std::array<uint8_t, RealSize::header> tmp;
-    for (size_t i = 0; i < RealSize::header; ++i) tmp[i] = _tree[i];
-    return deserialize_header(tmp);
+    if consteval {
+      std::array<uint8_t, RealSize::header> tmp;
+      for (size_t i = 0; i < RealSize::header; ++i) tmp[i] = _tree[i];
+      return deserialize_header(tmp);
+    } else {
+      Header out;
+      std::memcpy(&out, _tree.data(), RealSize::header);
+      return out;
+    }
   }  // read_global_node_header
 
   inline constexpr void write_global_node_header(const Header& _val, std::span<uint8_t> _tree) {
-    const auto res = serialize_header(_val);
-    for (size_t i = 0; i < res.size(); ++i) _tree[i] = res[i];
+    if consteval {
+      const auto res = serialize_header(_val);
+      for (size_t i = 0; i < res.size(); ++i) _tree[i] = res[i];
+    } else {
+      std::memcpy(_tree.data(), &_val, RealSize::header);
+    }
   }  // write_global_node_header
 
   //----------------------------------
 
   inline constexpr NodeHeader read_node_header(std::span<const uint8_t> _node) {
-    std::array<uint8_t, RealSize::node_header> tmp;
-    for (size_t i = 0; i < RealSize::node_header; ++i) tmp[i] = _node[i];
-    return deserialize_node_header(tmp);
+    if consteval {
+      std::array<uint8_t, RealSize::node_header> tmp;
+      for (size_t i = 0; i < RealSize::node_header; ++i) tmp[i] = _node[i];
+      return deserialize_node_header(tmp);
+    } else {
+      NodeHeader out;
+      std::memcpy(&out, _node.data(), RealSize::node_header);
+      return out;
+    }
   }  // read_node_header
 
   inline constexpr void write_node_header(const NodeHeader& _val, std::span<uint8_t> _node) {
-    const auto res = serialize_node_header(_val);
-    for (size_t i = 0; i < res.size(); ++i) _node[i] = res[i];
+    if consteval {
+      const auto res = serialize_node_header(_val);
+      for (size_t i = 0; i < res.size(); ++i) _node[i] = res[i];
+    } else {
+      std::memcpy(_node.data(), &_val, RealSize::node_header);
+    }
   }  // write_node_header
 
   //----------------------------------
 
   inline constexpr uint32_t read_root_child(const int32_t& _i, std::span<const uint8_t> _tree) {
-    std::array<uint8_t, sizeof(uint32_t)> tmp;
-    for (size_t i = 0; i < sizeof(uint32_t); ++i) tmp[i] = _tree[RealSize::header + _i * sizeof(uint32_t) + i];
-    return deserialize<uint32_t, sizeof(uint32_t)>(tmp);
+    if consteval {
+      std::array<uint8_t, sizeof(uint32_t)> tmp;
+      for (size_t i = 0; i < sizeof(uint32_t); ++i) tmp[i] = _tree[RealSize::header + _i * sizeof(uint32_t) + i];
+      return deserialize<uint32_t, sizeof(uint32_t)>(tmp);
+    } else {
+      uint32_t out;
+      std::memcpy(&out, _tree.data() + RealSize::header + _i * sizeof(uint32_t), sizeof(uint32_t));
+      return out;
+    }
   }  // read_root_child
 
   inline constexpr void write_root_child(const int32_t& _i, const uint32_t& _ptr, std::span<uint8_t> _tree) {
-    const auto res = serialize<uint32_t, sizeof(uint32_t)>(_ptr);
-    for (size_t i = 0; i < res.size(); ++i) _tree[RealSize::header + _i * sizeof(uint32_t) + i] = res[i];
+    if consteval {
+      const auto res = serialize<uint32_t, sizeof(uint32_t)>(_ptr);
+      for (size_t i = 0; i < res.size(); ++i) _tree[RealSize::header + _i * sizeof(uint32_t) + i] = res[i];
+    } else {
+      std::memcpy(_tree.data() + RealSize::header + _i * sizeof(uint32_t), &_ptr, sizeof(uint32_t));
+    }
   }  // write_root_child
 
   //----------------------------------
 
   inline constexpr uint32_t read_child(const int32_t& _i, std::span<const uint8_t> _node) {
-    std::array<uint8_t, sizeof(uint32_t)> tmp;
-    for (size_t i = 0; i < sizeof(uint32_t); ++i) tmp[i] = _node[RealSize::node_header + _i * sizeof(uint32_t) + i];
-    return deserialize<uint32_t, sizeof(uint32_t)>(tmp);
+    if consteval {
+      std::array<uint8_t, sizeof(uint32_t)> tmp;
+      for (size_t i = 0; i < sizeof(uint32_t); ++i) tmp[i] = _node[RealSize::node_header + _i * sizeof(uint32_t) + i];
+      return deserialize<uint32_t, sizeof(uint32_t)>(tmp);
+    } else {
+      uint32_t out;
+      std::memcpy(&out, _node.data() + RealSize::node_header + _i * sizeof(uint32_t), sizeof(uint32_t));
+      return out;
+    }
   }  // read_child
 
   inline constexpr void write_child(const int32_t& _i, const uint32_t& _ptr, std::span<uint8_t> _node) {
-    const auto res = serialize<uint32_t, sizeof(uint32_t)>(_ptr);
-    for (size_t i = 0; i < res.size(); ++i) _node[RealSize::node_header + _i * sizeof(uint32_t) + i] = res[i];
+    if consteval {
+      const auto res = serialize<uint32_t, sizeof(uint32_t)>(_ptr);
+      for (size_t i = 0; i < res.size(); ++i) _node[RealSize::node_header + _i * sizeof(uint32_t) + i] = res[i];
+    } else {
+      std::memcpy(_node.data() + RealSize::node_header + _i * sizeof(uint32_t), &_ptr, sizeof(uint32_t));
+    }
   }  // write_child
 
   //----------------------------------
 
   inline constexpr Composite read_composite(const NodeHeader& _header, std::span<const uint8_t> _node) {
-    std::array<uint8_t, RealSize::composite> tmp;
-    for (size_t i = 0; i < RealSize::composite; ++i) tmp[i] = _node[_header.comp_offset_ + i];
-    return deserialize_composite(tmp);
+    if consteval {
+      std::array<uint8_t, RealSize::composite> tmp;
+      for (size_t i = 0; i < RealSize::composite; ++i) tmp[i] = _node[_header.comp_offset_ + i];
+      return deserialize_composite(tmp);
+    } else {
+      Composite out;
+      std::memcpy(&out, _node.data() + _header.comp_offset_, RealSize::composite);
+      return out;
+    }
   }  // read_composite
 
   inline constexpr void write_composite(const Composite& _val, const NodeHeader& _header, std::span<uint8_t> _node) {
-    const auto res = serialize_composite(_val);
-    for (size_t i = 0; i < res.size(); ++i) _node[_header.comp_offset_ + i] = res[i];
+    if consteval {
+      const auto res = serialize_composite(_val);
+      for (size_t i = 0; i < res.size(); ++i) _node[_header.comp_offset_ + i] = res[i];
+    } else {
+      std::memcpy(_node.data() + _header.comp_offset_, &_val, RealSize::composite);
+    }
   }  // write_composite
 
   //----------------------------------
@@ -298,8 +396,12 @@ namespace TBT::Compiler {
     const uint8_t type     = _node[_header.params_offset_ + _i * size];
 
     std::array<uint8_t, sizeof(int32_t)> tmp;
-    for (size_t i = 0; i < sizeof(int32_t); ++i)
-      tmp[i] = _node[_header.params_offset_ + _i * size + sizeof(uint8_t) + i];
+    if consteval {
+      for (size_t i = 0; i < sizeof(int32_t); ++i)
+        tmp[i] = _node[_header.params_offset_ + _i * size + sizeof(uint8_t) + i];
+    } else {
+      std::memcpy(tmp.data(), _node.data() + _header.params_offset_ + _i * size + sizeof(uint8_t), sizeof(int32_t));
+    }
 
     if (type == pt_bool)
       return deserialize<int32_t, sizeof(int32_t)>(tmp) > 0;
@@ -399,9 +501,14 @@ namespace TBT::Compiler {
     for (const auto& r : parts) {                                                                    \
       if (r.empty()) continue;                                                                       \
                                                                                                      \
-      if (r[0] == '$') {                                                                             \
-        const std::optional<uint32_t> val = stn::StrToUInt32(std::string_view(&r[1], r.size() - 1)); \
-        if (val) { out.push_back(val.value()); }                                                     \
+      if (r[0] == '$' || r.starts_with("&$")) {                                                      \
+        const bool ref                    = r[0] == '&';                                             \
+        const bool move                   = r.ends_with("&&");                                       \
+        const size_t begin                = ref ? 2 : 1;                                             \
+        const size_t end                  = r.size() - (move ? 2 : 0);                               \
+        const std::optional<uint32_t> val = stn::StrToUInt32(r.substr(begin, end - begin));          \
+        if (val && !(ref && move) && (val.value() & bind_mask) == 0)                                 \
+          out.push_back(val.value() | (ref ? bind_ref : (move ? bind_move : bind_copy)));            \
         continue;                                                                                    \
       } else if (r == "true") {                                                                      \
         out.push_back(true);                                                                         \
@@ -522,6 +629,26 @@ namespace TBT::Compiler {
     uint32_t size_   = 0;
   };  // Node
 
+  // whether a task of this size is stored inline in the tree. larger ones are taken from the task pool
+  constexpr bool fits_inline(const size_t _size) { return _size <= TBT_MAX_INLINE_TASK_SIZE; }
+
+  // {size, alignment} of the largest task referenced by the nodes that fits inline. {0, 0} if there is none
+  template <class Variant>
+  constexpr std::pair<size_t, size_t> task_slot_layout(const std::vector<Node>& _nodes) {
+    constexpr auto layouts = variant_type_layouts<Variant>();
+
+    size_t size            = 0;
+    size_t align           = 1;
+    for (const Node& n : _nodes) {
+      if (!fits_inline(layouts[n.type_idx_].first)) continue;
+      size  = std::max(size, layouts[n.type_idx_].first);
+      align = std::max(align, layouts[n.type_idx_].second);
+    }
+
+    if (size == 0) return {0, 0};
+    return {size, align};
+  }  // task_slot_layout
+
   template <class Variant>
   constexpr size_t compute_size_static(const std::string_view& _s) {
     F_SPLIT
@@ -548,18 +675,24 @@ namespace TBT::Compiler {
     const auto nodes         = hh.value();
 
     //----------------------------------------------------
-    // ...|header|node header|children|params|composite|...
+    // ...|header|node header|children|params|composite|...|slot
 
     const auto root_children = gather_children(0, nodes);
 
-    size_t out               = RealSize::header + root_children.size() * sizeof(uint32_t);
+    size_t out = align_up(RealSize::header + root_children.size() * sizeof(uint32_t), RealSize::node_align);
 
     for (const Node& n : nodes) {
       const auto children = gather_children(n.node_id_, nodes);
-      out += RealSize::node_header + children.size() * sizeof(int32_t) + n.p_.size() * (1 + sizeof(int32_t)) +
-             RealSize::composite;
+      const size_t comp_offset =
+          align_up(RealSize::node_header + children.size() * sizeof(int32_t) + n.p_.size() * (1 + sizeof(int32_t)),
+                   alignof(Composite));
+      out += align_up(comp_offset + RealSize::composite, RealSize::node_align);
     }
 
+    // the slot is aligned at runtime. reserve enough space for any start address
+    const auto [slot_size, slot_align] = task_slot_layout<Variant>(nodes);
+    if (slot_size > 0) out += slot_size + slot_align - 1;
+
     return out;
   };  // compute_size_static
 
@@ -589,7 +722,7 @@ namespace TBT::Compiler {
     auto nodes               = hh.value();
 
     //----------------------------------------------------
-    // ...|header|node header|children|params|composite|...
+    // ...|header|node header|children|params|composite|...|slot
 
     const auto root_children = gather_children(0, nodes);
 
@@ -597,9 +730,8 @@ namespace TBT::Compiler {
     header.node_count_        = static_cast<decltype(header.node_count_)>(nodes.size());
     header.ptr_               = 0;
     header.children_count_    = static_cast<decltype(header.children_count_)>(root_children.size());
-    header.first_node_offset_ = RealSize::header + header.children_count_ * sizeof(uint32_t);
-
-    write_global_node_header(header, {_vals.begin(), _vals.end()});
+    header.first_node_offset_ = static_cast<decltype(header.first_node_offset_)>(
+        align_up(RealSize::header + header.children_count_ * sizeof(uint32_t), RealSize::node_align));
 
     uint32_t ptr = header.first_node_offset_;
     for (Node& n : nodes) {
@@ -614,9 +746,11 @@ namespace TBT::Compiler {
       nheader.params_count_    = static_cast<decltype(nheader.params_count_)>(n.p_.size());
       nheader.params_offset_   = nheader.children_offset_ + nheader.children_count_ * sizeof(int32_t);
 
-      nheader.comp_offset_     = nheader.params_offset_ + nheader.params_count_ * (1 + sizeof(int32_t));
+      nheader.comp_offset_     = static_cast<decltype(nheader.comp_offset_)>(
+          align_up(nheader.params_offset_ + nheader.params_count_ * (1 + sizeof(int32_t)), alignof(Composite)));
 
-      nheader.node_size_       = nheader.comp_offset_ + RealSize::composite;
+      nheader.node_size_       = static_cast<decltype(nheader.node_size_)>(
+          align_up(nheader.comp_offset_ + RealSize::composite, RealSize::node_align));
 
       n.offset_                = ptr;
       n.size_                  = nheader.node_size_;
@@ -627,15 +761,22 @@ namespace TBT::Compiler {
         write_payload(i, nheader, n.p_[i], {_vals.data() + ptr, nheader.node_size_});
 
       Composite cmp;
-      cmp.cur_idx_ = 0;
-      cmp.ptr_     = 0;
-      cmp.co_      = 0;
+      cmp.ptr_ = 0;
+      cmp.co_  = 0;
 
       write_composite(cmp, nheader, {_vals.data() + ptr, nheader.node_size_});
 
       ptr += nheader.node_size_;
     }
 
+    // the slot for the active task follows the last node
+    const auto [slot_size, slot_align] = task_slot_layout<Variant>(nodes);
+    header.slot_offset_                = slot_size > 0 ? ptr : 0;
+    header.slot_size_                  = static_cast<decltype(header.slot_size_)>(slot_size);
+    header.slot_align_                 = static_cast<decltype(header.slot_align_)>(slot_align);
+
+    write_global_node_header(header, {_vals.begin(), _vals.end()});
+
     // link root children
     int32_t cc = 0;
     for (const int32_t id : root_children) {
@@ -648,19 +789,29 @@ namespace TBT::Compiler {
       cc++;
     }
 
-    // link children and parent
-    for (const Node& n : nodes) {
+    // link successor, parent and children
+    for (size_t k = 0; k < nodes.size(); ++k) {
+      const Node& n  = nodes[k];
+      NodeHeader tar = read_node_header({_vals.data() + n.offset_, n.size_});
+
+      // the nodes are in pre-order. the successor is the next node that is not below n
+      for (size_t j = k + 1; j < nodes.size(); ++j) {
+        if (nodes[j].level_ <= n.level_) {
+          tar.next_ = nodes[j].offset_;
+          break;
+        }
+      }
+
       // parent
       if (n.parent_ != 0) {
-        NodeHeader tar = read_node_header({_vals.data() + n.offset_, n.size_});
         for (const auto& nc : nodes) {
           if (nc.node_id_ == n.parent_) {
             tar.parent_ = nc.offset_;
             break;
           }
         }
-        write_node_header(tar, {_vals.data() + n.offset_, tar.node_size_});
       }
+      write_node_header(tar, {_vals.data() + n.offset_, tar.node_size_});
 
       // children
       const auto children = gather_children(n.node_id_, nodes);
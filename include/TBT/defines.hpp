@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <cmath>
@@ -9,22 +10,45 @@
 #include <coroutine>
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <exception>
 #include <expected>
 #include <format>
 #include <forward_list>
 #include <functional>
 #include <future>
+#include <limits>
+#include <map>
+#include <mutex>
 #include <numeric>
 #include <optional>
 #include <stack>
 #include <stdfloat>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <typeindex>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
+// task states up to this size are stored inline in the tree, larger ones are taken from the task pool
+#ifndef TBT_MAX_INLINE_TASK_SIZE
+#define TBT_MAX_INLINE_TASK_SIZE 256
+#endif
+
+// prepared trees up to this size are stored inline in the ExecutionItem, larger ones are allocated with
+// TBT_TREE_ALLOCATOR
+#ifndef TBT_INLINE_TREE_SIZE
+#define TBT_INLINE_TREE_SIZE 512
+#endif
+
+#ifndef TBT_TREE_ALLOCATOR
+#define TBT_TREE_ALLOCATOR std::allocator<std::byte>
+#endif
+
 namespace TBT {
 
   using Parameter = std::variant<bool, int32_t, float, uint32_t>;
@@ -68,7 +92,8 @@ namespace TBT {
 #define SEXPAND(x) #x
 #define SEEXPAND(x) SEXPAND(x)
 
-  enum State : uint32_t { BUSY, FAILED, SUCCESS };
+  // CANCELLED is only reported for trees that were cancelled, tasks never return it
+  enum State : uint32_t { BUSY, FAILED, SUCCESS, CANCELLED };
 
   enum Direction : uint32_t { UP, DOWN };
 
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <TBT/execute.hpp>
+
+/*
+  Event channels. Trees wait for an event instead of polling for it.
+    > co_await channel.next(id) in a coroutine. it resumes with the payload of the next dispatch of id
+    > return channel.wait(id, subscription) from a legacy run(). run() is called again once id was dispatched
+    > a queued tree is parked while it waits (see Execute::Parking) and costs nothing per frame
+    > dispatch() is thread-safe and wakes every current subscriber of the id in the order they subscribed. woken trees
+      are put back all at once at the start of the next frame
+    > a subscription is one-shot. events dispatched before a tree subscribes again are not stored for it
+    > the channel has to outlive every tree waiting on it. declare it before the TaskQueue in the StateProvider
+*/
+
+namespace TBT {
+
+  template <class T = std::monostate>
+  struct EventChannel {
+    struct Subscription {
+      Subscription() = default;
+
+      // only valid while not subscribed
+      Subscription(Subscription&& _other) noexcept
+          : value_(std::move(_other.value_)), fired_(_other.fired_.load(std::memory_order_relaxed)) {
+        assert(_other.prev_ == nullptr);
+      }
+
+      Subscription& operator=(Subscription&& _other) noexcept {
+        assert(prev_ == nullptr && _other.prev_ == nullptr);
+        value_ = std::move(_other.value_);
+        fired_.store(_other.fired_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return *this;
+      }
+
+      ~Subscription() {
+        if (channel_) channel_->unsubscribe(*this);
+      }
+
+      // the event was dispatched. value_ holds its payload
+      [[nodiscard]] bool fired() const noexcept { return fired_.load(std::memory_order_acquire); }
+
+      T value_{};
+      std::atomic<bool> fired_        = false;
+      uint32_t id_                    = 0;  // the id it is subscribed to
+      Subscription* next_             = nullptr;
+      Subscription** prev_            = nullptr;  // null while not subscribed
+      EventChannel* channel_          = nullptr;  // the channel it was subscribed to last
+      Execute::Parking* parking_      = nullptr;  // legacy tasks in a queue
+      Execute::CoStateValues* values_ = nullptr;  // coroutines
+    };  // Subscription
+
+    // the subscribers of an id in the order they subscribed. lives in the map, it refers to itself
+    struct Waiters {
+      Waiters() = default;
+
+      Waiters(const Waiters&)            = delete;
+      Waiters& operator=(const Waiters&) = delete;
+
+      Subscription* head_  = nullptr;
+      Subscription** tail_ = &head_;  // next_ of the last subscriber
+    };  // Waiters
+
+    struct NextAwaitable {
+      Execute::CoStateValues* values_ = nullptr;
+      EventChannel* channel_          = nullptr;
+      uint32_t id_                    = 0;
+      Subscription sub_;
+
+      bool await_ready() noexcept { return false; }
+
+      template <class Handle>
+      void await_suspend(const Handle&) {
+        sub_.values_ = values_;
+        channel_->subscribe(id_, sub_);
+      }  // await_suspend
+
+      T await_resume() { return std::move(sub_.value_); }
+    };  // NextAwaitable
+
+    EventChannel() = default;
+
+    EventChannel(const EventChannel&)            = delete;
+    EventChannel& operator=(const EventChannel&) = delete;
+
+    // co_await next(id) resumes with the payload of the next dispatch of id
+    [[nodiscard]] NextAwaitable next(const uint32_t _id) {
+      return NextAwaitable{.channel_ = this, .id_ = _id, .sub_ = {}};
+    }  // next
+
+    // return wait(id, sub) from run(). the tree waits until id is dispatched, afterwards sub.fired() is true
+    // calling it again while still subscribed to _id keeps the subscription, a different id moves it over
+    [[nodiscard]] State wait(const uint32_t _id, Subscription& _s) {
+      std::scoped_lock lock(mutex_);
+      if (_s.prev_ && _s.id_ != _id) unlink(_s);
+      if (!_s.prev_) {
+        _s.fired_.store(false, std::memory_order_relaxed);
+        _s.values_ = nullptr;
+        link(_id, _s);
+      }
+      _s.parking_ = Execute::detail::current_parking_;
+      if (_s.parking_) _s.parking_->state_.store(Execute::Parking::AWAITING, std::memory_order_release);
+      return BUSY;
+    }  // wait
+
+    // wakes every tree waiting for _id and hands each a copy of _payload. returns how many there were
+    size_t dispatch(const uint32_t _id, const T& _payload = T{}) {
+      std::scoped_lock lock(mutex_);
+      const auto it = waiters_.find(_id);
+      if (it == waiters_.end()) return 0;
+
+      size_t n        = 0;
+      Subscription* s = it->second.head_;
+      waiters_.erase(it);
+      while (s) {
+        Subscription* next = s->next_;
+        s->next_           = nullptr;
+        s->prev_           = nullptr;
+        s->value_          = _payload;
+        subscribers_--;
+        n++;
+
+        // the subscription must not be touched anymore once the tree can continue
+        if (s->values_) {
+          s->values_->set_done();
+        } else {
+          Execute::Parking* p = s->parking_;
+          s->fired_.store(true, std::memory_order_release);
+          if (p) p->unpark();
+        }
+        s = next;
+      }
+      return n;
+    }  // dispatch
+
+    void subscribe(const uint32_t _id, Subscription& _s) {
+      std::scoped_lock lock(mutex_);
+      link(_id, _s);
+    }  // subscribe
+
+    void unsubscribe(Subscription& _s) {
+      std::scoped_lock lock(mutex_);
+      if (_s.prev_) unlink(_s);
+    }  // unsubscribe
+
+    // trees waiting on the channel
+    [[nodiscard]] size_t size() const noexcept { return subscribers_; }
+
+    // the mutex is held. appends _s to the subscribers of _id
+    void link(const uint32_t _id, Subscription& _s) {
+      assert(_s.prev_ == nullptr);
+      Waiters& w  = waiters_.try_emplace(_id).first->second;
+      _s.id_      = _id;
+      _s.next_    = nullptr;
+      _s.prev_    = w.tail_;
+      _s.channel_ = this;
+      *w.tail_    = &_s;
+      w.tail_     = &_s.next_;
+      subscribers_++;
+    }  // link
+
+    // the mutex is held. the entry of an id goes away with its last subscriber
+    void unlink(Subscription& _s) {
+      const auto it = waiters_.find(_s.id_);
+      assert(it != waiters_.end());
+      *_s.prev_ = _s.next_;
+      if (_s.next_)
+        _s.next_->prev_ = _s.prev_;
+      else
+        it->second.tail_ = _s.prev_;
+      _s.next_ = nullptr;
+      _s.prev_ = nullptr;
+      subscribers_--;
+      if (!it->second.head_) waiters_.erase(it);
+    }  // unlink
+
+    std::unordered_map<uint32_t, Waiters> waiters_;
+    size_t subscribers_ = 0;
+    std::mutex mutex_;
+  };  // EventChannel
+
+}  // namespace TBT
\ No newline at end of file
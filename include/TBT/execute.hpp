@@ -1,12 +1,17 @@
 #pragma once
 
 #include <TBT/compiler.hpp>
+#include <TBT/pool.hpp>
 #include <atomic>
 
 namespace TBT {
   template <class T, class Allocator>
   struct TreeAwaitable;
 
+  struct ExecutionItem;
+  struct TimerWheel;
+  struct Timers;
+
   namespace Execute {
     struct CoStateValues;
   }
@@ -16,8 +21,9 @@ namespace TBT {
   template <class T>
   struct Awaitable {
     T val_;
-    //  values_ will be populated by the promise
-    std::shared_ptr<Execute::CoStateValues> values_;
+    //  values_ will be populated by the promise. it points into the awaiting coroutine and is valid until the
+    //  coroutine was resumed or destroyed. set_done() must be called exactly once in between
+    Execute::CoStateValues* values_ = nullptr;
 
     Awaitable() = default;
 
@@ -44,45 +50,177 @@ namespace TBT::Execute {
   template <class Awaitable>
   struct CoStateAwaitable;
 
+  struct WakeList;
+  struct Parking;
+  struct CoStateValues;
+
+  // node of a timer wheel. lives in the Parking of the sleeping item
+  struct Timer {
+    Timer* next_           = nullptr;
+    Timer** prev_          = nullptr;  // the pointer pointing at this node. null while not in a wheel
+    uint64_t due_          = 0;
+    Parking* parking_      = nullptr;
+    CoStateValues* values_ = nullptr;  // set if a coroutine sleeps. it is woken through set_done()
+    TimerWheel* wheel_     = nullptr;  // the wheel it was linked into last
+  };  // Timer
+
+  /*
+    Parking of queued trees whose coroutine waits on an awaitable.
+      > the queue publishes the Parking of the item it executes. a coroutine suspending on an awaitable marks it
+      > an item that is still awaiting after its step is taken off the active list of the queue
+      > set_done() pushes a parked item onto the WakeList of its queue, from any thread. it runs again next frame
+      > trees stepped by hand inside a queued task must not park the queued tree. execute_instances takes care of it
+  */
+  struct Parking {
+    enum : uint32_t { RUNNING, AWAITING, PARKED };
+
+    Parking() = default;
+
+    // only valid while the item is neither executed nor parked
+    Parking(Parking&& _other) noexcept
+        : state_(_other.state_.load(std::memory_order_relaxed)),
+          list_(_other.list_),
+          timers_(_other.timers_),
+          item_(_other.item_) {}
+
+    Parking& operator=(Parking&& _other) noexcept {
+      state_.store(_other.state_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      list_   = _other.list_;
+      timers_ = _other.timers_;
+      item_   = _other.item_;
+      return *this;
+    }
+
+    std::atomic<uint32_t> state_ = RUNNING;
+    Parking* next_               = nullptr;  // next entry of the wake list
+    WakeList* list_              = nullptr;  // wake list of the queue owning the item
+    Timers* timers_              = nullptr;  // timer wheels of the queue owning the item
+    ExecutionItem* item_         = nullptr;
+    bool parked_                 = false;  // taken off the active list. only touched by the queue
+    bool waiting_                = false;  // the last call of the tree stopped at a task that waits
+    uint32_t index_              = 0;      // position among the parked items of the queue
+    Timer timer_;                          // used while the tree sleeps
+
+    // makes the tree runnable again. pushes it onto the wake list if it was parked already
+    void unpark() noexcept;
+  };  // Parking
+
+  // lock-free list of woken items. pushed from any thread, emptied at once by the queue
+  struct WakeList {
+    void push(Parking* _p) noexcept {
+      Parking* head = head_.load(std::memory_order_relaxed);
+      do {
+        _p->next_ = head;
+      } while (!head_.compare_exchange_weak(head, _p, std::memory_order_release, std::memory_order_relaxed));
+    }  // push
+
+    // everything pushed so far, oldest first
+    [[nodiscard]] Parking* take() noexcept {
+      Parking* p   = head_.exchange(nullptr, std::memory_order_acquire);
+      Parking* out = nullptr;
+      while (p) {
+        Parking* next = p->next_;
+        p->next_      = out;
+        out           = p;
+        p             = next;
+      }
+      return out;
+    }  // take
+
+    std::atomic<Parking*> head_ = nullptr;
+  };  // WakeList
+
+  inline void Parking::unpark() noexcept {
+    if (state_.exchange(RUNNING, std::memory_order_acq_rel) == PARKED) list_->push(this);
+  }  // unpark
+
+  namespace detail {
+    // the queued item executed on this thread
+    inline thread_local Parking* current_parking_ = nullptr;
+  }  // namespace detail
+
   struct CoStateValues {
-    State val_;
-    CoStateState state_;
+    State val_          = BUSY;
+    CoStateState state_ = YIELD;
     std::exception_ptr exception_;
     std::atomic<bool> a_done_ = false;
-    void set_done() { a_done_ = true; }
+    Parking* parking_         = nullptr;  // the queued tree of the coroutine, if any
+
+    void set_done() {
+      // the coroutine can be resumed and destroyed as soon as a_done_ is set. parking_ is read before
+      Parking* p        = parking_;
+      const bool parked = p && p->state_.exchange(Parking::RUNNING, std::memory_order_acq_rel) == Parking::PARKED;
+      a_done_           = true;
+      if (parked) p->list_->push(p);
+    }  // set_done
   };  // CoStateValues
 
+  namespace detail {
+    // stored in front of every coroutine frame. a null pool_ means the thread-local FramePool
+    struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) FrameHeader {
+      void (*release_)(void*, void*, size_t) noexcept;
+      void* pool_;
+    };  // FrameHeader
+
+    template <class Pool>
+    void* allocate_frame(const size_t _n, Pool* _pool) {
+      const size_t n = _n + sizeof(FrameHeader);
+      void* ptr      = _pool ? _pool->allocate(n) : FramePool<>::local().allocate(n);
+      const auto release = [](void* _p, void* _f, const size_t _s) noexcept {
+        static_cast<Pool*>(_p)->deallocate(_f, _s);
+      };
+      ::new (ptr) FrameHeader{release, _pool};
+      return static_cast<std::byte*>(ptr) + sizeof(FrameHeader);
+    }  // allocate_frame
+
+    inline void free_frame(void* _ptr, const size_t _n) noexcept {
+      void* ptr                 = static_cast<std::byte*>(_ptr) - sizeof(FrameHeader);
+      const FrameHeader& header = *std::launder(static_cast<FrameHeader*>(ptr));
+      if (header.pool_)
+        header.release_(header.pool_, ptr, _n + sizeof(FrameHeader));
+      else
+        FramePool<>::local().deallocate(ptr, _n + sizeof(FrameHeader));
+    }  // free_frame
+  }  // namespace detail
+
   struct CoState {
     struct promise_type {
-      std::shared_ptr<CoStateValues> values_;
+      CoStateValues values_;
 
-      CoState get_return_object() {
-        values_ = std::make_shared<CoStateValues>();
-        return CoState(values_, std::coroutine_handle<CoState::promise_type>::from_promise(*this));
+      // frames come from the frame_pool_ of the StateProvider if present, otherwise from the thread-local FramePool
+      template <class Task, class StateProvider>
+        requires requires(StateProvider& _s) { _s.frame_pool_.deallocate(_s.frame_pool_.allocate(size_t{}), size_t{}); }
+      static void* operator new(const size_t _n, Task&, StateProvider& _states) {
+        return detail::allocate_frame(_n, &_states.frame_pool_);
       }
 
+      static void* operator new(const size_t _n) { return detail::allocate_frame<FramePool<>>(_n, nullptr); }
+      static void operator delete(void* _ptr, const size_t _n) noexcept { detail::free_frame(_ptr, _n); }
+
+      CoState get_return_object() { return CoState(std::coroutine_handle<CoState::promise_type>::from_promise(*this)); }
+
       std::suspend_never initial_suspend() noexcept { return {}; }
       std::suspend_always final_suspend() noexcept { return {}; }
 
       template <class T>
       std::suspend_always yield_value(T&&) {
-        values_->state_ = CoStateState::YIELD;
-        values_->val_   = BUSY;
+        values_.state_ = CoStateState::YIELD;
+        values_.val_   = BUSY;
         return {};
       }
 
       void return_value(const State _val) noexcept {
-        values_->state_ = CoStateState::RETURN;
-        values_->val_   = _val;
+        values_.state_ = CoStateState::RETURN;
+        values_.val_   = _val;
       }
 
-      void unhandled_exception() noexcept { values_->exception_ = std::current_exception(); }
+      void unhandled_exception() noexcept { values_.exception_ = std::current_exception(); }
 
       template <class T>
       CoStateAwaitable<Awaitable<T>> await_transform(Awaitable<T>&& _a) {
-        values_->state_  = CoStateState::AWAIT;
-        values_->a_done_ = false;
-        _a.values_       = values_;
+        values_.state_  = CoStateState::AWAIT;
+        values_.a_done_ = false;
+        _a.values_      = &values_;
         CoStateAwaitable<Awaitable<T>> out(std::move(_a));
         // out.values_ = values_;
         return out;
@@ -90,19 +228,19 @@ namespace TBT::Execute {
 
       template <class T, class Allocator>
       CoStateAwaitable<TreeAwaitable<T, Allocator>> await_transform(TreeAwaitable<T, Allocator>&& _a) {
-        values_->state_  = CoStateState::AWAIT;
-        values_->a_done_ = false;
+        values_.state_  = CoStateState::AWAIT;
+        values_.a_done_ = false;
         //_a.values_      = values_;
         CoStateAwaitable<TreeAwaitable<T, Allocator>> out(std::move(_a));
-        out.other_.ref_->values_ = values_;
+        out.other_.ref_->values_ = &values_;
         return out;
       };
 
       template <class Awaitable>
       CoStateAwaitable<Awaitable> await_transform(Awaitable&& _a) {
-        values_->state_  = CoStateState::AWAIT;
-        values_->a_done_ = false;
-        _a.values_       = values_;
+        values_.state_  = CoStateState::AWAIT;
+        values_.a_done_ = false;
+        _a.values_      = &values_;
         CoStateAwaitable<Awaitable> out(std::move(_a));
         // out.values_ = values_;
         return out;
@@ -110,16 +248,15 @@ namespace TBT::Execute {
 
     };  // promise_type
 
-    std::shared_ptr<CoStateValues> values_;
+    // the values live in the promise. the CoState does not own the coroutine
     std::coroutine_handle<CoState::promise_type> handle_;
 
     CoState() = default;
-    explicit CoState(std::shared_ptr<CoStateValues> _values, std::coroutine_handle<CoState::promise_type> _handle)
-        : values_(std::move(_values)), handle_(std::move(_handle)) {}
+    explicit CoState(std::coroutine_handle<CoState::promise_type> _handle) : handle_(_handle) {}
 
-    State get_value() { return values_->val_; }
-    CoStateState get_costate() { return values_->state_; }
-    bool is_awaitable_done() { return values_->a_done_; }
+    State get_value() { return handle_.promise().values_.val_; }
+    CoStateState get_costate() { return handle_.promise().values_.state_; }
+    bool is_awaitable_done() { return handle_.promise().values_.a_done_; }
 
   };  // CoState
 
@@ -133,6 +270,11 @@ namespace TBT::Execute {
       using handle = std::coroutine_handle<CoState::promise_type>;
       //((handle*)&_h)->promise().parent_ = other_.values_;
       //_h.promise().parent_ = other_.values_;
+
+      // the queue may park the tree until set_done() is called
+      Parking* p                    = detail::current_parking_;
+      _h.promise().values_.parking_ = p;
+      if (p) p->state_.store(Parking::AWAITING, std::memory_order_release);
       other_.await_suspend(_h);  //
     }
     auto await_resume() noexcept {
@@ -201,6 +343,14 @@ namespace TBT::Execute {
       return result;
     }  // corun_mask_for
 
+    //-----------------------------------
+    // batched run. evaluates the same task of many tree instances at once (see instances.hpp)
+
+    template <class TaskDerived, class StateProvider>
+    concept has_run_batch = requires(std::span<TaskDerived> tasks, StateProvider state, std::span<State> results) {
+      { run_batch(tasks, state, results) };
+    };
+
     //-----------------------------------
     // concepts for all valid exit signatures
 
@@ -214,19 +364,25 @@ namespace TBT::Execute {
       { exit(task) };
     };
 
+    //-----------------------------------
+    // a StateProvider can bring its own pool for the task states
+
+    template <class StateProvider, class Variant>
+    concept has_task_pool = requires(StateProvider state) {
+      { state.task_pool_.allocate() } -> std::same_as<void*>;
+      { state.task_pool_.deallocate(nullptr) };
+    } && std::remove_cvref_t<decltype(std::declval<StateProvider>().task_pool_)>::block_size >= sizeof(Variant);
+
   }  // namespace Concepts
 
-  // template <typename... Ts>
-  // std::variant<std::decay_t<Ts>...> tuple_element_to_variant(const std::tuple<Ts...>& tuple, size_t _index) {
-  //   std::variant<std::decay_t<Ts>...> result;
-  //   std::apply(
-  //       [&](const auto&... elements) {
-  //         size_t i = 0;
-  //         ((i++ == _index ? (result = elements) : result), ...);
-  //       },
-  //       tuple);
-  //   return result;
-  // }  // tuple_element_to_variant
+  // the pool of the StateProvider if present, otherwise the thread-local fallback
+  template <class Variant, class StateProvider>
+  [[nodiscard]] auto& task_pool(StateProvider& _states) {
+    if constexpr (Concepts::has_task_pool<StateProvider, Variant>)
+      return _states.task_pool_;
+    else
+      return TaskPool<Variant>::local();
+  }  // task_pool
 
   namespace detail {
     template <std::size_t I, class... Ts>
@@ -234,6 +390,87 @@ namespace TBT::Execute {
       return std::variant<Ts...>(std::in_place_index<I>, std::get<I>(tt));
     }
 
+    // a parameter of a tree compiled at runtime doesn't fit the member of its task. there is no way to go on
+    [[noreturn]] inline void bind_error(const char* _what) {
+      std::fprintf(stderr, "TBT: %s\n", _what);
+      std::abort();
+    }  // bind_error
+
+    // whether argument I can be bound to the field with _Mode, one of Compiler::bind_*
+    template <size_t I, uint32_t Mode, class Field, class Params>
+    consteval bool can_bind_arg() {
+      using Arg = std::decay_t<std::tuple_element_t<I, std::remove_const_t<Params>>>;
+      if constexpr (Mode == Compiler::bind_ref)
+        return std::is_pointer_v<Field> && std::is_same_v<std::remove_const_t<std::remove_pointer_t<Field>>, Arg> &&
+               std::is_convertible_v<decltype(&std::get<I>(std::declval<Params&>())), Field>;
+      else
+        return std::is_same_v<Field, Arg> &&
+               (std::is_copy_assignable_v<Arg> || (!std::is_const_v<Params> && std::is_move_assignable_v<Arg>));
+    }  // can_bind_arg
+
+    // binds argument I to the field, Mode is one of Compiler::bind_*. the argument is never copied on the way
+    //   > copy: move-only arguments are moved, so only the first node binding them gets them
+    //   > ref:  the field is a pointer to the argument
+    //   > move: the argument is moved, later nodes binding it get the moved-from value
+    template <size_t I, uint32_t Mode, class Field, class Params>
+    void bind_arg(Field& _field, Params& _params) {
+      static_assert(can_bind_arg<I, Mode, Field, Params>(),
+                    "$n and $n&& need a member of the type of argument n, &$n a pointer to it");
+      using Arg = std::decay_t<std::tuple_element_t<I, std::remove_const_t<Params>>>;
+
+      if constexpr (Mode == Compiler::bind_ref) {
+        _field = &std::get<I>(_params);
+      } else {
+        if constexpr (Mode == Compiler::bind_move && !std::is_const_v<Params> && std::is_move_assignable_v<Arg>) {
+          _field = std::move(std::get<I>(_params));
+          return;
+        }
+
+        if constexpr (std::is_copy_assignable_v<Arg>)
+          _field = std::get<I>(_params);
+        else
+          _field = std::move(std::get<I>(_params));
+      }
+    }  // bind_arg
+
+    // assigns a static payload. only bool, float and signed ints are allowed, the payload must hold the field's type
+    template <class Field>
+    void bind_payload(Field& _field, const Parameter& _pl) {
+      if constexpr (std::is_same_v<Field, bool> || std::is_same_v<Field, int32_t> || std::is_same_v<Field, float>) {
+        if (const Field* v = std::get_if<Field>(&_pl))
+          _field = *v;
+        else
+          bind_error("a static payload needs a member of its type");
+      } else {
+        bind_error("only bool, float and signed ints are allowed as static payload");
+      }
+    }  // bind_payload
+
+    // binds argument _arg of the tuple, _mode is one of Compiler::bind_*
+    template <class Field, class Params>
+    void bind_dynamic(Field& _field, Params& _params, const size_t _arg, const uint32_t _mode) {
+      constexpr size_t args_size = std::tuple_size_v<std::remove_const_t<Params>>;
+      if (_arg >= args_size) bind_error("the tree uses more dynamic parameters than were passed");
+
+      const auto bind = [&]<size_t I, uint32_t Mode>() {
+        if constexpr (can_bind_arg<I, Mode, Field, Params>())
+          bind_arg<I, Mode>(_field, _params);
+        else
+          bind_error("$n and $n&& need a member of the type of argument n, &$n a pointer to it");
+      };
+
+      if constexpr (args_size > 0) {
+        [&]<size_t... Is>(std::index_sequence<Is...>) {
+          ((Is == _arg ? (_mode == Compiler::bind_ref    ? bind.template operator()<Is, Compiler::bind_ref>()
+                          : _mode == Compiler::bind_move ? bind.template operator()<Is, Compiler::bind_move>()
+                                                         : bind.template operator()<Is, Compiler::bind_copy>(),
+                          true)
+                       : false) ||
+           ...);
+        }(std::make_index_sequence<args_size>{});
+      }
+    }  // bind_dynamic
+
   }  // namespace detail
 
   template <class... Ts>
@@ -245,150 +482,140 @@ namespace TBT::Execute {
     return table[i](t);
   }
 
-  template <class Task, class... Ts>
-  [[nodiscard]] Task construct_task(const std::vector<uint32_t>& _idxs,
-                                    const std::vector<std::variant<bool, int32_t, float, uint32_t>>& _pl,
-                                    const std::tuple<Ts...>& _params) {
-    static_assert(std::is_class_v<Task>, "Task must be a class/struct");
-
-    // this creates a copy of all params. maybe not the best way
-    const auto args          = _params;
+  // std::visit for a task of alternative _idx stored at _ptr
+  template <class Variant, class F>
+  decltype(auto) visit_task(F&& _f, int32_t _idx, void* _ptr) {
+    constexpr size_t variant_size = std::variant_size_v<Variant>;
+    assert(_idx >= 0 && _idx < (int32_t)variant_size);
 
-    constexpr auto args_size = std::tuple_size_v<std::decay_t<decltype(_params)>>;
-    constexpr auto N         = glz::reflect<Task>::size;
+    using R                       = std::invoke_result_t<F, std::variant_alternative_t<0, Variant>&>;
+    constexpr auto table          = []<size_t... Is>(std::index_sequence<Is...>) {
+      return std::array<R (*)(F&, void*), sizeof...(Is)>{[](F& _visitor, void* _task) -> R {
+        return _visitor(*std::launder(reinterpret_cast<std::variant_alternative_t<Is, Variant>*>(_task)));
+      }...};
+    }(std::make_index_sequence<variant_size>{});
 
-    Task out;
+    return table[_idx](_f, _ptr);
+  }  // visit_task
 
-    // default constructed
-    if (args_size + _pl.size() == 0) return out;
+  // assigns the parameters of a node straight from the compiled tree. field i gets parameter i
+  template <class Task, class Params>
+  void bind_node_task(Task& _task, const Compiler::NodeHeader& _header, std::span<const uint8_t> _node,
+                      Params& _params) {
+    constexpr size_t N = glz::reflect<Task>::size;
 
-    // if not default constructed the params will be matched in order
     if constexpr (N > 0) {
-      auto tie = glz::to_tie(out);
-
-      for (size_t i = 0; i < N; ++i) {
-        // more members than payloads
-        if (i >= _idxs.size()) break;
-
-        const auto field = glz::detail::get_runtime(tie, i);
-
-        // dynamic payload
-        if (_idxs[i] >= _pl.size()) {
-          if constexpr (args_size > 0) {
-            const auto val = tuple_element_to_variant(args, _idxs[i] - _pl.size());
-
-            std::visit(
-                [&](auto p, auto& v) {
-                  using ValueType   = std::decay_t<decltype(v)>;
-                  using PointerType = std::remove_pointer_t<std::decay_t<decltype(p)>>;
-                  if constexpr (std::is_same_v<PointerType, ValueType>) *p = std::move(v);
-                },
-                field, val);
-          }
-        }
-
-        // static payload
-        else {
-          std::visit(
-              [&](auto ptr) {
-                if constexpr (std::is_same_v<bool, std::decay_t<std::remove_pointer_t<decltype(ptr)>>>) {
-                  if (_pl[_idxs[i]].index() == 0) *ptr = std::get<0>(_pl[_idxs[i]]);
-                } else if constexpr (std::is_same_v<int32_t, std::decay_t<std::remove_pointer_t<decltype(ptr)>>>) {
-                  if (_pl[_idxs[i]].index() == 1) *ptr = std::get<1>(_pl[_idxs[i]]);
-                } else if constexpr (std::is_same_v<float, std::decay_t<std::remove_pointer_t<decltype(ptr)>>>) {
-                  if (_pl[_idxs[i]].index() == 2) *ptr = std::get<2>(_pl[_idxs[i]]);
-                } else {
-                  // only bool, float and signed ints are allowed as static payload
-                  std::unreachable();
-                }
-              },
-              field);
-        }
-      }
+      auto tie = glz::to_tie(_task);
+
+      [&]<size_t... Fs>(std::index_sequence<Fs...>) {
+        (
+            [&]() {
+              if (Fs >= _header.params_count_) return;
+              auto& field        = glz::get<Fs>(tie);
+              const Parameter pl = Compiler::read_payload(Fs, _header, _node);
+              if (pl.index() == 3)
+                detail::bind_dynamic(field, _params, std::get<3>(pl) & ~Compiler::bind_mask,
+                                     std::get<3>(pl) & Compiler::bind_mask);
+              else
+                detail::bind_payload(field, pl);
+            }(),
+            ...);
+      }(std::make_index_sequence<N>{});
     }
+  }  // bind_node_task
 
-    return out;
-  }  // construct_task
-
-  template <class Variant, class... Ts>
-  [[nodiscard]] Variant* alloc_task(uint32_t _idx, const std::vector<uint32_t>& _idxs,
-                                    const std::vector<std::variant<bool, int32_t, float, uint32_t>>& _pl,
-                                    const std::tuple<Ts...>& _params) {
+  // constructs the task of alternative _idx in the storage at _ptr and binds the parameters of its node
+  template <class Variant, class Params>
+  void emplace_task_at(void* _ptr, int32_t _idx, const Compiler::NodeHeader& _header, std::span<const uint8_t> _node,
+                       Params& _params) {
     constexpr size_t variant_size = std::variant_size_v<Variant>;
-    assert(_idx < variant_size);
-    Variant* v            = new Variant();
+    assert(_idx >= 0 && _idx < (int32_t)variant_size);
 
-    auto construct_params = [&]<size_t... Is>(std::index_sequence<Is...>) {
-      ((Is == _idx ? ((*v = construct_task<std::variant_alternative_t<Is, Variant>>(_idxs, _pl, _params)), true)
-                   : false),
+    [&]<size_t... Is>(std::index_sequence<Is...>) {
+      ((Is == (size_t)_idx ? (bind_node_task(*::new (_ptr) std::variant_alternative_t<Is, Variant>(), _header, _node,
+                                             _params),
+                              true)
+                           : false),
        ...);
-    };
-
-    auto construct = [v, _idx]<size_t... Is>(std::index_sequence<Is...>) {
-      ((Is == _idx ? (v->template emplace<Is>(), true) : false), ...);
-    };
-
-    if (_idxs.empty())
-      construct(std::make_index_sequence<variant_size>{});
-    else
-      construct_params(std::make_index_sequence<variant_size>{});
-
-    return v;
-  }  // alloc_task
-
-  template <class Variant, class StateProvider, class... Ts>
+    }(std::make_index_sequence<variant_size>{});
+  }  // emplace_task_at
+
+  template <class Variant>
+  void destroy_task_at(void* _ptr, int32_t _idx) noexcept {
+    visit_task<Variant>([](auto& _t) { std::destroy_at(&_t); }, _idx, _ptr);
+  }  // destroy_task_at
+
+  // address of the inline task slot of the tree or nullptr if the tree has none
+  inline void* task_slot(const Compiler::Header& _header, std::span<uint8_t> _tree) {
+    if (_header.slot_size_ == 0) return nullptr;
+    void* ptr    = _tree.data() + _header.slot_offset_;
+    size_t space = _header.slot_size_ + _header.slot_align_ - 1;
+    return std::align(_header.slot_align_, _header.slot_size_, ptr, space);
+  }  // task_slot
+
+  // Composite::ptr_ of a task that lives in the slot of its tree. the slot is found again on every call, so a tree can
+  // be moved with its active task
+  inline constexpr intptr_t in_slot = 1;
+
+  [[nodiscard]] inline intptr_t task_ref(void* _state, void* _slot) {
+    return _state == _slot ? in_slot : reinterpret_cast<intptr_t>(_state);
+  }  // task_ref
+
+  [[nodiscard]] inline void* task_state(const Compiler::Composite& _task, void* _slot) {
+    return _task.ptr_ == in_slot ? _slot : reinterpret_cast<void*>(_task.ptr_);
+  }  // task_state
+
+  template <class Variant, class StateProvider, class Params>
   State execute_task(std::span<uint8_t> _node, Compiler::Header& _global_header, const Compiler::NodeHeader& _header,
-                     StateProvider& _states, const std::tuple<Ts...>& _params) {
+                     void* _slot, StateProvider& _states, Params&& _params) {
     using namespace Compiler;
 
-    Composite task = read_composite(_header, _node);
+    Composite task     = read_composite(_header, _node);
 
-    // first time entering the task
-    if (_global_header.last_result_.dir_ == DOWN) {
-      // create mapping
-      std::vector<uint32_t> idcs;
-
-      std::vector<std::variant<bool, int32_t, float, uint32_t>> payloads;
-
-      std::vector<int32_t> d_ics;
-
-      uint32_t s_pl = 0;
-      for (int32_t i = 0; i < _header.params_count_; ++i) {
-        const auto pl = read_payload(i, _header, _node);
+    // the state is either stored in the slot of the tree or in a block of the task pool
+    const auto release = [&](void* _state) {
+      destroy_task_at<Variant>(_state, _header.type_idx_);
+      if (_state != _slot) task_pool<Variant>(_states).deallocate(_state);
+    };
 
-        switch (pl.index()) {
-          case 3: {
-            idcs.push_back(std::get<3>(pl));  // idx into dynamic params
-            d_ics.push_back(i);
-          } break;
-          default:
-            payloads.push_back(std::move(pl));
-            idcs.push_back(s_pl++);  // idx into static params
-            break;
-        }
+    // the task is done. a successful task goes on with its first child, everything else jumps to the node after its
+    // subtree. returns to the root after the last node
+    const auto leave = [&](const State _res) {
+      if (_res != FAILED && _header.children_count_ > 0) {
+        _global_header.ptr_              = read_child(0, _node);
+        _global_header.last_result_.dir_ = DOWN;
+      } else {
+        _global_header.ptr_              = _header.next_;
+        _global_header.last_result_.dir_ = _header.next_ ? DOWN : UP;
       }
+      _global_header.last_result_.state_ = _res;
+    };
 
-      // add offset to dynamic params
-      for (const int32_t i : d_ics) idcs[i] += (uint32_t)payloads.size();
-
+    // first time entering the task
+    if (_global_header.last_result_.dir_ == DOWN) {
       constexpr auto co_mask = Concepts::corun_mask_for<Variant, std::decay_t<StateProvider>>();
+      constexpr auto layouts = Compiler::variant_type_layouts<Variant>();
 
-      Variant* state         = alloc_task<Variant>(_header.type_idx_, idcs, payloads, _params);
+      // a coroutine keeps a reference to its task, it goes to the pool so that the tree can still be moved. so do
+      // tasks too large for the slot
+      const bool in_tree = _slot && !co_mask[_header.type_idx_] && fits_inline(layouts[_header.type_idx_].first);
+      void* state        = in_tree ? _slot : task_pool<Variant>(_states).allocate();
+      emplace_task_at<Variant>(state, _header.type_idx_, _header, _node, _params);
 
-      const bool is_co       = std::visit(
+      const bool is_co       = visit_task<Variant>(
           [&](auto& _t) {
             if constexpr (Concepts::is_corun<std::decay_t<decltype(_t)>, std::decay_t<StateProvider>>)
               return true;
             else
               return false;
           },
-          *state);
+          _header.type_idx_, state);
 
       // a coroutine
       if (is_co) {
         // start the coroutine
         CoState cstate;
-        std::visit(
+        visit_task<Variant>(
             [&](auto& _t) {
               if constexpr (Concepts::has_corun_sig_1<std::decay_t<decltype(_t)>, std::decay_t<StateProvider>>) {
                 cstate = co_run(_t, _states);
@@ -396,7 +623,7 @@ namespace TBT::Execute {
                 cstate = co_run(_t);
               }
             },
-            *state);
+            _header.type_idx_, state);
 
         // check the state of the coroutine
         const CoStateState res = cstate.get_costate();
@@ -406,7 +633,7 @@ namespace TBT::Execute {
             // the tasks wants to wait. write states and return.
             const State value = cstate.get_value();
             assert(value == BUSY);
-            task.ptr_                          = reinterpret_cast<intptr_t>(state);
+            task.ptr_                          = task_ref(state, _slot);
             task.co_                           = reinterpret_cast<intptr_t>(cstate.handle_.address());
             _global_header.last_result_.dir_   = UP;
             _global_header.last_result_.state_ = value;
@@ -414,37 +641,26 @@ namespace TBT::Execute {
             return BUSY;
           }
           case RETURN: {  // the coroutine has co_returned
-            std::visit(
+            visit_task<Variant>(
                 [&](auto& _t) {
                   if constexpr (Concepts::has_exit_sig_1<std::decay_t<decltype(_t)>, std::decay_t<StateProvider>>)
                     exit(_t, _states);
                   else if constexpr (Concepts::has_exit_sig_2<std::decay_t<decltype(_t)>>)
                     exit(_t);
                 },
-                *state);
+                _header.type_idx_, state);
 
-            delete state;
+            release(state);
             task.ptr_         = 0;
             task.co_          = 0;
-            // cres.coro_.destroy();
             const State value = cstate.get_value();
-            // return to parent if no children or last child or failed
-            if (value == FAILED || task.cur_idx_ >= _header.children_count_) {
-              task.cur_idx_                    = 0;
-              _global_header.ptr_              = _header.parent_;
-              _global_header.last_result_.dir_ = UP;
-            } else {
-              const uint32_t optr              = read_child(task.cur_idx_, _node);
-              _global_header.last_result_.dir_ = DOWN;
-              task.cur_idx_++;
-              _global_header.ptr_ = optr;
-            }
+            cstate.handle_.destroy();
             write_composite(task, _header, _node);
-            _global_header.last_result_.state_ = value;
+            leave(value);
             return BUSY;
           }
           case AWAIT: {  // task will wait until the awaitable has finished
-            task.ptr_                          = reinterpret_cast<intptr_t>(state);
+            task.ptr_                          = task_ref(state, _slot);
             task.co_                           = reinterpret_cast<intptr_t>(cstate.handle_.address());
             _global_header.last_result_.dir_   = UP;
             _global_header.last_result_.state_ = BUSY;
@@ -458,43 +674,40 @@ namespace TBT::Execute {
       else {
         // init the task
         {
-          State res;
-          std::visit(
+          State res = SUCCESS;
+          visit_task<Variant>(
               [&](auto& _t) {
                 if constexpr (Concepts::has_init_sig_1<std::decay_t<decltype(_t)>, std::decay_t<StateProvider>>)
                   res = init(_t, _states);
                 else if constexpr (Concepts::has_init_sig_2<std::decay_t<decltype(_t)>>)
                   res = init(_t);
               },
-              *state);
+              _header.type_idx_, state);
 
           // the task failed. return to parent
           if (res == FAILED) {
             // call exit if present
-            std::visit(
+            visit_task<Variant>(
                 [&](auto& _t) {
                   if constexpr (Concepts::has_exit_sig_1<std::decay_t<decltype(_t)>, std::decay_t<StateProvider>>)
                     exit(_t, _states);
                   else if constexpr (Concepts::has_exit_sig_2<std::decay_t<decltype(_t)>>)
                     exit(_t);
                 },
-                *state);
+                _header.type_idx_, state);
 
-            delete state;
+            release(state);
             task.ptr_ = 0;
             task.co_  = 0;
             write_composite(task, _header, _node);
-
-            _global_header.ptr_                = _header.parent_;
-            _global_header.last_result_.dir_   = UP;
-            _global_header.last_result_.state_ = res;
+            leave(res);
             return BUSY;
           }
         }
 
         // the task succeeded. check if wait exists, else return
         {
-          std::optional<State> res = std::visit(
+          std::optional<State> res = visit_task<Variant>(
               [&](auto& _t) -> std::optional<State> {
                 if constexpr (Concepts::has_run_sig_1<std::decay_t<decltype(_t)>, std::decay_t<StateProvider>>)
                   return run(_t, _states);
@@ -503,44 +716,32 @@ namespace TBT::Execute {
                 else
                   return std::nullopt;
               },
-              *state);
+              _header.type_idx_, state);
 
           // no wait signature found and run succeed: task is done
           // if the task is not busy return to parent or next child
           if (!res || (res && (*res == FAILED || *res == SUCCESS))) {
             // call exit if present
-            std::visit(
+            visit_task<Variant>(
                 [&](auto& _t) {
                   if constexpr (Concepts::has_exit_sig_1<std::decay_t<decltype(_t)>, std::decay_t<StateProvider>>)
                     exit(_t, _states);
                   else if constexpr (Concepts::has_exit_sig_2<std::decay_t<decltype(_t)>>)
                     exit(_t);
                 },
-                *state);
+                _header.type_idx_, state);
 
-            delete state;
+            release(state);
             task.ptr_ = 0;
             task.co_  = 0;
-
-            // return to parent if no children or last child
-            if (*res == FAILED || task.cur_idx_ >= _header.children_count_) {
-              task.cur_idx_                    = 0;
-              _global_header.ptr_              = _header.parent_;
-              _global_header.last_result_.dir_ = UP;
-            } else {
-              const uint32_t optr              = read_child(task.cur_idx_, _node);
-              _global_header.last_result_.dir_ = DOWN;
-              task.cur_idx_++;
-              _global_header.ptr_ = optr;
-            }
             write_composite(task, _header, _node);
 
             // either wait has returned a state or the state must be success from run
-            _global_header.last_result_.state_ = res ? *res : SUCCESS;
+            leave(res.value_or(SUCCESS));
             return BUSY;
           }
           // the tasks wants to wait. write states and return.
-          task.ptr_                          = reinterpret_cast<intptr_t>(state);
+          task.ptr_                          = task_ref(state, _slot);
           _global_header.last_result_.dir_   = UP;
           _global_header.last_result_.state_ = *res;
           write_composite(task, _header, _node);
@@ -551,45 +752,27 @@ namespace TBT::Execute {
 
     //------------------------------------------------------------
 
-    // re enter. either the task returned BUSY or returning from a child or coyielded or coawaited
+    // re enter. either the task returned BUSY or coyielded or coawaited
     else {
-      // returning from a child. go to next or return to parent
-      if (task.ptr_ == 0) {
-        if (_global_header.last_result_.state_ != State::BUSY) {
-          if (task.cur_idx_ >= _header.children_count_) {
-            task.cur_idx_                    = 0;
-            _global_header.ptr_              = _header.parent_;
-            _global_header.last_result_.dir_ = UP;
-          } else {
-            const uint32_t optr              = read_child(task.cur_idx_, _node);
-            _global_header.last_result_.dir_ = DOWN;
-            task.cur_idx_++;
-            write_composite(task, _header, _node);
-            _global_header.ptr_ = optr;
-          }
-          return _global_header.last_result_.state_;
-        }
-      }
-
       // keep running the task
       assert(task.ptr_ != 0);
-      Variant* state   = reinterpret_cast<Variant*>(task.ptr_);
+      void* state      = task_state(task, _slot);
 
-      const bool is_co = std::visit(
+      const bool is_co = visit_task<Variant>(
           [&](auto& _t) {
             if constexpr (Concepts::is_corun<std::decay_t<decltype(_t)>, std::decay_t<StateProvider>>)
               return true;
             else
               return false;
           },
-          *state);
+          _header.type_idx_, state);
 
       // a coroutine
       if (is_co) {
         assert(task.co_ != 0);
 
         auto co_handle = std::coroutine_handle<CoState::promise_type>::from_address(reinterpret_cast<void*>(task.co_));
-        CoState co_state(co_handle.promise().values_, co_handle);
+        CoState co_state(co_handle);
 
         // check last costate
         const CoStateState res_prev = co_state.get_costate();
@@ -622,15 +805,15 @@ namespace TBT::Execute {
             return BUSY;
           }
           case RETURN: {  // the coroutine has co_returned
-            std::visit(
+            visit_task<Variant>(
                 [&](auto& _t) {
                   if constexpr (Concepts::has_exit_sig_1<std::decay_t<decltype(_t)>, std::decay_t<StateProvider>>)
                     exit(_t, _states);
                   else if constexpr (Concepts::has_exit_sig_2<std::decay_t<decltype(_t)>>)
                     exit(_t);
                 },
-                *state);
-            delete state;
+                _header.type_idx_, state);
+            release(state);
             task.ptr_         = 0;
             task.co_          = 0;
             // cres.coro_.destroy();
@@ -638,19 +821,8 @@ namespace TBT::Execute {
             // if (co_state.parent_) co_state.parent_->set_done();
             const State value = co_state.get_value();
             co_state.handle_.destroy();  // finalise the coroutine
-            // return to parent if no children or last child or failed
-            if (value == FAILED || task.cur_idx_ >= _header.children_count_) {
-              task.cur_idx_                    = 0;
-              _global_header.ptr_              = _header.parent_;
-              _global_header.last_result_.dir_ = UP;
-            } else {
-              const uint32_t optr              = read_child(task.cur_idx_, _node);
-              _global_header.last_result_.dir_ = DOWN;
-              task.cur_idx_++;
-              _global_header.ptr_ = optr;
-            }
             write_composite(task, _header, _node);
-            _global_header.last_result_.state_ = value;
+            leave(value);
             return BUSY;
           }
           case AWAIT: {  // task will wait until the awaitable has finished
@@ -663,47 +835,33 @@ namespace TBT::Execute {
 
       // not a coroutin
       else {
-        State res;
-        std::visit(
+        State res = SUCCESS;
+        visit_task<Variant>(
             [&](auto& _t) {
               if constexpr (Concepts::has_run_sig_1<std::decay_t<decltype(_t)>, std::decay_t<StateProvider>>)
                 res = run(_t, _states);
               else if constexpr (Concepts::has_run_sig_2<std::decay_t<decltype(_t)>>)
                 res = run(_t);
             },
-            *state);
+            _header.type_idx_, state);
 
         // task is finished
         if (res == FAILED || res == SUCCESS) {
           // call exit if present
-          std::visit(
+          visit_task<Variant>(
               [&](auto& _t) {
                 if constexpr (Concepts::has_exit_sig_1<std::decay_t<decltype(_t)>, std::decay_t<StateProvider>>)
                   exit(_t, _states);
                 else if constexpr (Concepts::has_exit_sig_2<std::decay_t<decltype(_t)>>)
                   exit(_t);
               },
-              *state);
+              _header.type_idx_, state);
 
-          delete state;
+          release(state);
           task.ptr_ = 0;
           task.co_  = 0;
-
-          // return to parent if no children or last child
-          if (res == FAILED || task.cur_idx_ >= _header.children_count_) {
-            task.cur_idx_                    = 0;
-            _global_header.ptr_              = _header.parent_;
-            _global_header.last_result_.dir_ = UP;
-          } else {
-            const uint32_t optr              = read_child(task.cur_idx_, _node);
-            _global_header.last_result_.dir_ = DOWN;
-            task.cur_idx_++;
-            _global_header.ptr_ = optr;
-          }
-
           write_composite(task, _header, _node);
-          // either wait has returned a state or the state must be success from run
-          _global_header.last_result_.state_ = res;
+          leave(res);
           return BUSY;
         }
 
@@ -717,65 +875,191 @@ namespace TBT::Execute {
     return BUSY;
   }  // execute_task
 
-  template <class Variant, class Tree, class StateProvider, class... Ts>
-  State execute_step(Tree& _tree, StateProvider&& _states, const std::tuple<Ts...>& _params) {
-    // static_assert(std::is_same_v<Tree, DynamicTree> || std::is_same_v<Tree, StaticTree>);
+  namespace detail {
+    // visits the node the cursor points at and moves the cursor on. the global header is only read and written by
+    // the caller
+    template <class Variant, class StateProvider, class Params>
+    State step_node(std::span<uint8_t> _tree, Compiler::Header& _global_header, void* _slot, StateProvider& _states,
+                    Params& _params) {
+      using namespace Compiler;
+
+      // if first entry. if yes set the pointer to the first node
+      const bool first_entry =
+          _global_header.ptr_ < _global_header.first_node_offset_ && _global_header.last_result_.dir_ == DOWN;
+      if (first_entry) _global_header.ptr_ = _global_header.first_node_offset_;
+
+      // read header of current node
+      const NodeHeader cur_node_header = read_node_header(_tree.subspan(_global_header.ptr_));
+
+      assert(cur_node_header.type_idx_ >= 0 || cur_node_header.type_idx_ < (int32_t)std::variant_size_v<Variant>);
+      execute_task<Variant>(_tree.subspan(_global_header.ptr_, cur_node_header.node_size_), _global_header,
+                            cur_node_header, _slot, _states, _params);
+
+      // the last node was left. the tree is done
+      if (_global_header.last_result_.dir_ == UP && _global_header.ptr_ == 0) {
+        // reset the tree
+        _global_header.last_result_.dir_ = DOWN;
+        return SUCCESS;
+      }
+      return BUSY;
+    }  // step_node
+  }  // namespace detail
 
+  template <class Variant, class Tree, class StateProvider, class Params>
+  State execute_step(Tree& _tree, StateProvider&& _states, Params&& _params) {
     using namespace Compiler;
 
-    // read global header
-    Header global_header = read_global_node_header({_tree.begin(), _tree.end()});
+    const std::span<uint8_t> tree{_tree.begin(), _tree.end()};
+    Header global_header = read_global_node_header(tree);
+    void* const slot     = task_slot(global_header, tree);
+    const State r        = detail::step_node<Variant>(tree, global_header, slot, _states, _params);
+    write_global_node_header(global_header, tree);
+    return r;
+  }  // execute_step
+
+  /*
+    Runs node after node in one call, until
+      > a task returns BUSY, yields or awaits
+      > the tree is done
+      > _steps nodes were visited
+      > the queued tree executed on this thread stops, e.g. because it cancelled itself
+    The header is read once and written back once. _steps is set to the number of visited nodes. execute_step is the
+    same with _steps = 1
+    Stopping at a waiting task sets waiting_ in the Parking of the queued tree, the queue ends FULL_* modes on it
+  */
+  template <class Variant, class Tree, class StateProvider, class Params>
+  State execute_steps(Tree& _tree, StateProvider&& _states, Params&& _params, size_t& _steps) {
+    using namespace Compiler;
 
-    // if first entry. if yes set the pointer to the first child and reset index
-    const bool first_entry =
-        global_header.ptr_ < global_header.first_node_offset_ && global_header.last_result_.dir_ == DOWN;
-    if (first_entry) {
-      global_header.ptr_       = global_header.first_node_offset_;
-      global_header.child_idx_ = 0;
+    const std::span<uint8_t> tree{_tree.begin(), _tree.end()};
+    Header global_header   = read_global_node_header(tree);
+    void* const slot       = task_slot(global_header, tree);
+    Parking* const parking = detail::current_parking_;
+    const size_t limit     = _steps;
+
+    State r  = BUSY;
+    size_t n = 0;
+    while (n < limit) {
+      n++;
+      r = detail::step_node<Variant>(tree, global_header, slot, _states, _params);
+      if (r != BUSY) break;
+      // only a waiting task leaves BUSY behind
+      if (global_header.last_result_.state_ == BUSY) {
+        if (parking) parking->waiting_ = true;
+        break;
+      }
+      if (parking && parking->state_.load(std::memory_order_relaxed) != Parking::RUNNING) break;
     }
+    write_global_node_header(global_header, tree);
+    _steps = n;
+    return r;
+  }  // execute_steps
+
+  // unwinds a tree stopped in the middle. the coroutine frame of the active task is destroyed, exit is called and the
+  // task state is released. the tree starts over at the root afterwards
+  template <class Variant, class Tree, class StateProvider>
+  void teardown(Tree& _tree, StateProvider& _states) {
+    using namespace Compiler;
 
-    // read header of current node
-    const NodeHeader cur_node_header = read_node_header({_tree.begin() + global_header.ptr_, _tree.end()});
+    // moved from or never started
+    if (_tree.size() == 0) return;
+    Header global_header = read_global_node_header({_tree.begin(), _tree.end()});
+    if (global_header.ptr_ == 0 && global_header.last_result_.dir_ == DOWN) return;
 
-    assert(cur_node_header.type_idx_ >= 0 || cur_node_header.type_idx_ < (int16_t)std::variant_size_v<Variant>);
-    execute_task<Variant>({_tree.begin() + global_header.ptr_, cur_node_header.node_size_}, global_header,
-                          cur_node_header, _states, _params);
+    if (global_header.ptr_ >= global_header.first_node_offset_) {
+      const NodeHeader header = read_node_header({_tree.begin() + global_header.ptr_, _tree.end()});
+      std::span<uint8_t> node{_tree.begin() + global_header.ptr_, header.node_size_};
+      Composite task = read_composite(header, node);
 
-    // check if returned to root
-    if (global_header.last_result_.dir_ == UP && global_header.ptr_ == 0) {
-      global_header.child_idx_++;
+      if (task.ptr_ != 0) {
+        void* state = task_state(task, task_slot(global_header, {_tree.begin(), _tree.end()}));
+        if (task.co_ != 0) std::coroutine_handle<>::from_address(reinterpret_cast<void*>(task.co_)).destroy();
 
-      // the last task was executed. the tree is done
-      if (global_header.child_idx_ >= global_header.children_count_) {
-        // reset the tree
-        global_header.child_idx_        = 0;
-        global_header.ptr_              = 0;
-        global_header.last_result_.dir_ = DOWN;
-        write_global_node_header(global_header, {_tree.begin(), _tree.end()});
-        return SUCCESS;
-      }
-      // proceed to next child
-      else {
-        global_header.ptr_              = read_root_child(global_header.child_idx_, {_tree.begin(), _tree.end()});
+        visit_task<Variant>(
+            [&](auto& _t) {
+              if constexpr (Concepts::has_exit_sig_1<std::decay_t<decltype(_t)>, std::decay_t<StateProvider>>)
+                exit(_t, _states);
+              else if constexpr (Concepts::has_exit_sig_2<std::decay_t<decltype(_t)>>)
+                exit(_t);
+            },
+            header.type_idx_, state);
 
-        global_header.last_result_.dir_ = DOWN;
-        write_global_node_header(global_header, {_tree.begin(), _tree.end()});
-        return BUSY;
+        destroy_task_at<Variant>(state, header.type_idx_);
+        if (task.ptr_ != in_slot) task_pool<Variant>(_states).deallocate(state);
       }
     }
 
+    // the positions of all nodes
+    uint32_t ptr = global_header.first_node_offset_;
+    for (uint32_t i = 0; i < global_header.node_count_; ++i) {
+      const NodeHeader header = read_node_header({_tree.begin() + ptr, _tree.end()});
+      std::span<uint8_t> node{_tree.begin() + ptr, header.node_size_};
+      write_composite(Composite{}, header, node);
+      ptr += header.node_size_;
+    }
+
+    global_header.ptr_         = 0;
+    global_header.last_result_ = {};
     write_global_node_header(global_header, {_tree.begin(), _tree.end()});
-    return BUSY;
+  }  // teardown
 
-  }  // execute
+  // the tree _from was moved into _to. an active task in the slot of _from is moved into the slot of _to. trees that
+  // share their storage, e.g. a moved vector, have nothing to move
+  template <class Variant, class Tree>
+  void relocate_task(Tree& _from, Tree& _to) {
+    using namespace Compiler;
+
+    if (_from.size() == 0 || _from.data() == _to.data()) return;
+    const std::span<uint8_t> from{_from.begin(), _from.end()};
+    const Header global_header = read_global_node_header(from);
+    if (global_header.ptr_ < global_header.first_node_offset_) return;
+
+    const NodeHeader header = read_node_header(from.subspan(global_header.ptr_));
+    const Composite task    = read_composite(header, from.subspan(global_header.ptr_, header.node_size_));
+    if (task.ptr_ != in_slot) return;
+
+    void* const to = task_slot(global_header, {_to.begin(), _to.end()});
+    visit_task<Variant>(
+        [&](auto& _t) {
+          ::new (to) std::decay_t<decltype(_t)>(std::move(_t));
+          std::destroy_at(&_t);
+        },
+        header.type_idx_, task_slot(global_header, from));
+  }  // relocate_task
+
+  // a tree prepared for the dynamic engine. destroying it mid-flight tears the tree down. moving it takes the active
+  // task along, the moved from tree is left without one
+  template <class Variant, class Tree, class StateProvider, class Params>
+  struct PreparedTree {
+    PreparedTree(Tree _tree, StateProvider& _states, Params _params)
+        : tree_(std::move(_tree)), states_(_states), params_(std::move(_params)) {}
+
+    PreparedTree(PreparedTree&& _other) noexcept
+        : tree_(std::move(_other.tree_)), states_(_other.states_), params_(std::move(_other.params_)) {
+      relocate_task<Variant>(_other.tree_, tree_);
+      _other.owner_ = false;
+    }
+    PreparedTree& operator=(PreparedTree&&) = delete;
+
+    ~PreparedTree() {
+      if (owner_) teardown<Variant>(tree_, states_.get());
+    }
+
+    State operator()() { return execute_step<Variant>(tree_, states_.get(), params_); }
+    State operator()(size_t& _steps) { return execute_steps<Variant>(tree_, states_.get(), params_, _steps); }
+
+    Tree tree_;
+    std::reference_wrapper<StateProvider> states_;
+    Params params_;
+    bool owner_ = true;  // false once moved from
+  };  // PreparedTree
 
   // prepares for the execution of a tree
+  // the active task lives inside the tree, moving the returned callable moves the task. it must not be copied
   template <class Variant, class Tree, class StateProvider, class... Ts>
-  [[nodiscard]] std::function<State()> prepare(Tree _tree, StateProvider& _states, Ts... _ts) {
-    return [tree = std::move(_tree), states = std::ref(_states),
-            params = std::make_tuple(std::move(_ts)...)]() mutable -> State {
-      return execute_step<Variant>(tree, states.get(), params);
-    };
+  [[nodiscard]] auto prepare(Tree _tree, StateProvider& _states, Ts... _ts) {
+    return PreparedTree<Variant, Tree, StateProvider, std::tuple<Ts...>>(std::move(_tree), _states,
+                                                                         std::make_tuple(std::move(_ts)...));
   }  // prepare
 
 }  // namespace TBT::Execute
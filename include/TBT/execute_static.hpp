@@ -0,0 +1,469 @@
+#pragma once
+
+#include <TBT/execute.hpp>
+
+/*
+  Execution engine for trees that are known at compile time.
+    > the compiled tree is a template argument. the shape and the type of every node are resolved by the compiler
+    > every node gets its own step function that calls init/run/co_run/exit of the concrete task directly
+    > the tree itself is never written. everything that changes during execution lives in StaticTreeState
+*/
+
+namespace TBT::Execute {
+
+  // the node tables of a compiled tree. nodes are numbered in pre-order, node_count is used for the root
+  template <auto Tree>
+  struct StaticLayout {
+    static constexpr Compiler::Header header = Compiler::read_global_node_header(Tree);
+    static constexpr uint32_t node_count     = header.node_count_;
+    static constexpr uint32_t root           = node_count;
+
+    static constexpr auto offsets            = []() {
+      std::array<uint32_t, node_count> out{};
+      uint32_t ptr = header.first_node_offset_;
+      for (uint32_t i = 0; i < node_count; ++i) {
+        out[i] = ptr;
+        ptr += Compiler::read_node_header({Tree.begin() + ptr, Tree.end()}).node_size_;
+      }
+      return out;
+    }();
+
+    static constexpr auto nodes = []() {
+      std::array<Compiler::NodeHeader, node_count> out{};
+      for (uint32_t i = 0; i < node_count; ++i)
+        out[i] = Compiler::read_node_header({Tree.begin() + offsets[i], Tree.end()});
+      return out;
+    }();
+
+    static constexpr uint32_t index_of(const uint32_t _offset) {
+      for (uint32_t i = 0; i < node_count; ++i)
+        if (offsets[i] == _offset) return i;
+      return root;
+    }  // index_of
+
+    static constexpr auto parents = []() {
+      std::array<uint32_t, node_count> out{};
+      for (uint32_t i = 0; i < node_count; ++i) out[i] = index_of(nodes[i].parent_);
+      return out;
+    }();
+
+    // the node after the subtree of node i. root after the last node
+    static constexpr auto next = []() {
+      std::array<uint32_t, node_count> out{};
+      for (uint32_t i = 0; i < node_count; ++i) out[i] = index_of(nodes[i].next_);
+      return out;
+    }();
+
+    // the children of node i are children[child_begin[i]] ... children[child_begin[i] + children_count_ - 1]
+    static constexpr auto child_begin = []() {
+      std::array<uint32_t, node_count> out{};
+      uint32_t n = 0;
+      for (uint32_t i = 0; i < node_count; ++i) {
+        out[i] = n;
+        n += nodes[i].children_count_;
+      }
+      return out;
+    }();
+
+    static constexpr uint32_t children_total = []() {
+      uint32_t n = 0;
+      for (uint32_t i = 0; i < node_count; ++i) n += nodes[i].children_count_;
+      return n;
+    }();
+
+    static constexpr auto children = []() {
+      std::array<uint32_t, children_total> out{};
+      for (uint32_t i = 0; i < node_count; ++i)
+        for (uint32_t c = 0; c < nodes[i].children_count_; ++c)
+          out[child_begin[i] + c] = index_of(Compiler::read_child(c, {Tree.begin() + offsets[i], Tree.end()}));
+      return out;
+    }();
+
+    static constexpr auto root_children = []() {
+      std::array<uint32_t, header.children_count_> out{};
+      for (uint32_t c = 0; c < header.children_count_; ++c)
+        out[c] = index_of(Compiler::read_root_child(c, Tree));
+      return out;
+    }();
+
+    // {size, alignment} of the largest task of the tree
+    template <class Variant>
+    static constexpr std::pair<size_t, size_t> slot_layout() {
+      constexpr auto layouts = Compiler::variant_type_layouts<Variant>();
+      size_t size            = 1;
+      size_t align           = 1;
+      for (uint32_t i = 0; i < node_count; ++i) {
+        size  = std::max(size, layouts[nodes[i].type_idx_].first);
+        align = std::max(align, layouts[nodes[i].type_idx_].second);
+      }
+      return {size, align};
+    }  // slot_layout
+  };  // StaticLayout
+
+  // everything that changes while a static tree runs. moving it moves the active task along and leaves the moved from
+  // state at the root. a coroutine keeps a reference to its task, its task lives in a block of the task pool instead
+  // of the slot
+  template <class Variant, auto Tree>
+  struct StaticTreeState {
+    using Layout = StaticLayout<Tree>;
+
+    StaticTreeState() = default;
+    StaticTreeState(StaticTreeState&& _other) noexcept
+        : node_(_other.node_), last_result_(_other.last_result_), live_(_other.live_), co_(_other.co_),
+          co_task_(_other.co_task_) {
+      if constexpr (Layout::node_count > 0) {
+        if (live_ && !co_task_) {
+          [&]<uint32_t... Is>(std::integer_sequence<uint32_t, Is...>) {
+            (
+                [&]() {
+                  if (node_ != Is) return;
+                  using Task = std::variant_alternative_t<Layout::nodes[Is].type_idx_, Variant>;
+                  Task* task = std::launder(reinterpret_cast<Task*>(_other.slot_));
+                  ::new (slot_) Task(std::move(*task));
+                  std::destroy_at(task);
+                }(),
+                ...);
+          }(std::make_integer_sequence<uint32_t, Layout::node_count>{});
+        }
+      }
+      _other.node_        = Layout::root;
+      _other.last_result_ = {};
+      _other.live_        = false;
+      _other.co_          = {};
+      _other.co_task_     = nullptr;
+    }
+    StaticTreeState& operator=(StaticTreeState&&) = delete;
+
+    uint32_t node_ = Layout::root;
+    Compiler::Result last_result_;
+    bool live_ = false;
+    std::coroutine_handle<CoState::promise_type> co_;
+    void* co_task_ = nullptr;  // the task of the active coroutine
+
+    static constexpr auto slot_layout = Layout::template slot_layout<Variant>();
+    alignas(slot_layout.second) std::byte slot_[slot_layout.first];
+  };  // StaticTreeState
+
+  // rejects parameters of node I that don't fit the members of its task
+  //   > a static payload needs a member of exactly its type
+  //   > $n and $n&& need a member of the type of argument n, &$n a pointer to it
+  // parameters beyond the last member are ignored
+  template <class Variant, auto Tree, uint32_t I, class Params>
+  void check_node_bindings() {
+    using Layout                                 = StaticLayout<Tree>;
+    using Task                                   = std::variant_alternative_t<Layout::nodes[I].type_idx_, Variant>;
+    static constexpr Compiler::NodeHeader header = Layout::nodes[I];
+    constexpr size_t N                           = glz::reflect<Task>::size;
+
+    [&]<size_t... Fs>(std::index_sequence<Fs...>) {
+      (
+          [&]() {
+            constexpr Parameter pl =
+                Compiler::read_payload(Fs, header, {Tree.begin() + Layout::offsets[I], Tree.end()});
+            using Field = std::remove_cvref_t<decltype(glz::get<Fs>(glz::to_tie(std::declval<Task&>())))>;
+
+            if constexpr (pl.index() == 3) {
+              constexpr uint32_t idx = std::get<3>(pl) & ~Compiler::bind_mask;
+              static_assert(idx < std::tuple_size_v<Params>, "the tree uses more dynamic parameters than were passed");
+              constexpr uint32_t mode = std::get<3>(pl) & Compiler::bind_mask;
+
+              if constexpr (mode == Compiler::bind_ref)
+                static_assert(Execute::detail::can_bind_arg<idx, mode, Field, Params>(),
+                              "&$n needs a pointer member to the type of argument n");
+              else
+                static_assert(Execute::detail::can_bind_arg<idx, mode, Field, Params>(),
+                              "$n needs a member of the type of argument n");
+            } else {
+              static_assert(std::is_same_v<Field, std::variant_alternative_t<pl.index(), Parameter>>,
+                            "a static payload needs a member of its type. "
+                            "only bool, float and signed ints are allowed");
+            }
+          }(),
+          ...);
+    }(std::make_index_sequence<std::min<size_t>(N, header.params_count_)>{});
+  }  // check_node_bindings
+
+  // checks the parameters of every node of the tree at compile time
+  template <class Variant, auto Tree, class Params>
+  void check_bindings() {
+    [&]<uint32_t... Is>(std::integer_sequence<uint32_t, Is...>) {
+      (check_node_bindings<Variant, Tree, Is, Params>(), ...);
+    }(std::make_integer_sequence<uint32_t, StaticLayout<Tree>::node_count>{});
+  }  // check_bindings
+
+  // assigns the parameters of node I to the members of the task. mirrors bind_node_task
+  template <auto Tree, uint32_t I, class Task, class Params>
+  void bind_static_task(Task& _task, Params& _params) {
+    using Layout                                 = StaticLayout<Tree>;
+    static constexpr Compiler::NodeHeader header = Layout::nodes[I];
+    constexpr size_t N                           = std::min<size_t>(glz::reflect<Task>::size, header.params_count_);
+
+    if constexpr (N > 0) {
+      auto tie = glz::to_tie(_task);
+
+      [&]<size_t... Fs>(std::index_sequence<Fs...>) {
+        (
+            [&]() {
+              constexpr Parameter pl =
+                  Compiler::read_payload(Fs, header, {Tree.begin() + Layout::offsets[I], Tree.end()});
+              auto& field = glz::get<Fs>(tie);  // references to the members, as in bind_node_task
+              using Field = std::decay_t<decltype(field)>;
+
+              // dynamic payload
+              if constexpr (pl.index() == 3) {
+                constexpr uint32_t idx  = std::get<3>(pl) & ~Compiler::bind_mask;
+                constexpr uint32_t mode = std::get<3>(pl) & Compiler::bind_mask;
+                static_assert(idx < std::tuple_size_v<std::remove_const_t<Params>>,
+                              "the tree uses more dynamic parameters than were passed");
+                Execute::detail::bind_arg<idx, mode>(field, _params);
+              }
+              // static payload
+              else {
+                static_assert(std::is_same_v<Field, bool> || std::is_same_v<Field, int32_t> ||
+                                  std::is_same_v<Field, float>,
+                              "only bool, float and signed ints are allowed as static payload");
+                static_assert(std::is_same_v<Field, std::variant_alternative_t<pl.index(), Parameter>>,
+                              "a static payload needs a member of its type");
+                field = std::get<pl.index()>(pl);
+              }
+            }(),
+            ...);
+      }(std::make_index_sequence<N>{});
+    }
+  }  // bind_static_task
+
+  template <class Variant, auto Tree, uint32_t I, class StateProvider, class Params>
+  void execute_node_static(StaticTreeState<Variant, Tree>& _tree, StateProvider& _states, Params& _params) {
+    using namespace Compiler;
+    using Layout                          = StaticLayout<Tree>;
+    using SP                              = std::decay_t<StateProvider>;
+    using Task                            = std::variant_alternative_t<Layout::nodes[I].type_idx_, Variant>;
+    static constexpr uint32_t child_count = Layout::nodes[I].children_count_;
+
+    Task* task                            = nullptr;
+    if constexpr (Concepts::is_corun<Task, SP>)
+      task = static_cast<Task*>(_tree.co_task_);
+    else
+      task = std::launder(reinterpret_cast<Task*>(_tree.slot_));
+
+    // the task is done. a failed task skips its children, the last node returns to the root
+    const auto finish = [&](const State _res) {
+      if constexpr (Concepts::has_exit_sig_1<Task, SP>)
+        exit(*task, _states);
+      else if constexpr (Concepts::has_exit_sig_2<Task>)
+        exit(*task);
+
+      if constexpr (Concepts::is_corun<Task, SP>) {
+        _tree.co_.destroy();
+        _tree.co_ = {};
+      }
+      std::destroy_at(task);
+      if constexpr (Concepts::is_corun<Task, SP>) {
+        task_pool<Variant>(_states).deallocate(_tree.co_task_);
+        _tree.co_task_ = nullptr;
+      }
+      _tree.live_ = false;
+
+      if constexpr (child_count > 0) {
+        if (_res != FAILED) {
+          _tree.node_        = Layout::children[Layout::child_begin[I]];
+          _tree.last_result_ = {_res, DOWN};
+          return;
+        }
+      }
+      _tree.node_        = Layout::next[I];
+      _tree.last_result_ = {_res, Layout::next[I] == Layout::root ? UP : DOWN};
+    };
+
+    const auto check_coroutine = [&]() {
+      const CoStateValues& values = _tree.co_.promise().values_;
+      if (values.state_ == RETURN)
+        finish(values.val_);
+      else
+        _tree.last_result_ = {BUSY, UP};
+    };
+
+    // first time entering the task
+    if (_tree.last_result_.dir_ == DOWN) {
+      if constexpr (Concepts::is_corun<Task, SP>) {
+        _tree.co_task_ = task_pool<Variant>(_states).allocate();
+        task           = ::new (_tree.co_task_) Task();
+      } else {
+        task = ::new (_tree.slot_) Task();
+      }
+      bind_static_task<Tree, I>(*task, _params);
+      _tree.live_ = true;
+
+      if constexpr (Concepts::is_corun<Task, SP>) {
+        if constexpr (Concepts::has_corun_sig_1<Task, SP>)
+          _tree.co_ = co_run(*task, _states).handle_;
+        else
+          _tree.co_ = co_run(*task).handle_;
+        check_coroutine();
+      } else {
+        State res = SUCCESS;
+        if constexpr (Concepts::has_init_sig_1<Task, SP>)
+          res = init(*task, _states);
+        else if constexpr (Concepts::has_init_sig_2<Task>)
+          res = init(*task);
+
+        if (res != FAILED) {
+          if constexpr (Concepts::has_run_sig_1<Task, SP>)
+            res = run(*task, _states);
+          else if constexpr (Concepts::has_run_sig_2<Task>)
+            res = run(*task);
+        }
+
+        if (res == BUSY)
+          _tree.last_result_ = {BUSY, UP};
+        else
+          finish(res);
+      }
+      return;
+    }
+
+    // keep running the task
+    if constexpr (Concepts::is_corun<Task, SP>) {
+      const CoStateValues& values = _tree.co_.promise().values_;
+      assert(values.state_ != RETURN);
+      if (values.state_ == YIELD || (values.state_ == AWAIT && values.a_done_)) _tree.co_.resume();
+      check_coroutine();
+    } else {
+      State res = SUCCESS;
+      if constexpr (Concepts::has_run_sig_1<Task, SP>)
+        res = run(*task, _states);
+      else if constexpr (Concepts::has_run_sig_2<Task>)
+        res = run(*task);
+
+      if (res == BUSY)
+        _tree.last_result_ = {BUSY, UP};
+      else
+        finish(res);
+    }
+  }  // execute_node_static
+
+  // same contract as execute_step
+  template <class Variant, auto Tree, class StateProvider, class Params>
+  State execute_step_static(StaticTreeState<Variant, Tree>& _tree, StateProvider& _states, Params&& _params) {
+    using namespace Compiler;
+    using Layout = StaticLayout<Tree>;
+
+    if constexpr (Layout::node_count == 0) {
+      return SUCCESS;
+    } else {
+      // first entry
+      if (_tree.node_ == Layout::root && _tree.last_result_.dir_ == DOWN) _tree.node_ = Layout::root_children[0];
+
+      [&]<uint32_t... Is>(std::integer_sequence<uint32_t, Is...>) {
+        ((_tree.node_ == Is ? (execute_node_static<Variant, Tree, Is>(_tree, _states, _params), true) : false) || ...);
+      }(std::make_integer_sequence<uint32_t, Layout::node_count>{});
+
+      // the last node was left. the tree is done
+      if (_tree.last_result_.dir_ == UP && _tree.node_ == Layout::root) {
+        _tree.last_result_.dir_ = DOWN;
+        return SUCCESS;
+      }
+      return BUSY;
+    }
+  }  // execute_step_static
+
+  // same contract as execute_steps
+  template <class Variant, auto Tree, class StateProvider, class Params>
+  State execute_steps_static(StaticTreeState<Variant, Tree>& _tree, StateProvider& _states, Params&& _params,
+                             size_t& _steps) {
+    Parking* const parking = detail::current_parking_;
+    const size_t limit     = _steps;
+
+    State r  = BUSY;
+    size_t n = 0;
+    while (n < limit) {
+      n++;
+      r = execute_step_static<Variant, Tree>(_tree, _states, _params);
+      if (r != BUSY) break;
+      // only a waiting task leaves BUSY behind
+      if (_tree.last_result_.state_ == BUSY) {
+        if (parking) parking->waiting_ = true;
+        break;
+      }
+      if (parking && parking->state_.load(std::memory_order_relaxed) != Parking::RUNNING) break;
+    }
+    _steps = n;
+    return r;
+  }  // execute_steps_static
+
+  // same as teardown for the dynamic engine
+  template <class Variant, auto Tree, class StateProvider>
+  void teardown_static(StaticTreeState<Variant, Tree>& _tree, StateProvider& _states) {
+    using Layout = StaticLayout<Tree>;
+    using SP     = std::decay_t<StateProvider>;
+
+    if constexpr (Layout::node_count > 0) {
+      if (_tree.live_) {
+        [&]<uint32_t... Is>(std::integer_sequence<uint32_t, Is...>) {
+          (
+              [&]() {
+                if (_tree.node_ != Is) return;
+                using Task = std::variant_alternative_t<Layout::nodes[Is].type_idx_, Variant>;
+                Task* task = nullptr;
+                if constexpr (Concepts::is_corun<Task, SP>)
+                  task = static_cast<Task*>(_tree.co_task_);
+                else
+                  task = std::launder(reinterpret_cast<Task*>(_tree.slot_));
+
+                if constexpr (Concepts::is_corun<Task, SP>) _tree.co_.destroy();
+                if constexpr (Concepts::has_exit_sig_1<Task, SP>)
+                  exit(*task, _states);
+                else if constexpr (Concepts::has_exit_sig_2<Task>)
+                  exit(*task);
+                std::destroy_at(task);
+                if constexpr (Concepts::is_corun<Task, SP>) task_pool<Variant>(_states).deallocate(_tree.co_task_);
+              }(),
+              ...);
+        }(std::make_integer_sequence<uint32_t, Layout::node_count>{});
+      }
+    }
+
+    _tree.node_        = Layout::root;
+    _tree.last_result_ = {};
+    _tree.live_        = false;
+    _tree.co_          = {};
+    _tree.co_task_     = nullptr;
+  }  // teardown_static
+
+  // a tree prepared for the static engine. destroying it mid-flight tears the tree down
+  template <class Variant, auto Tree, class StateProvider, class Params>
+  struct PreparedStaticTree {
+    PreparedStaticTree(StateProvider& _states, Params _params) : states_(_states), params_(std::move(_params)) {}
+
+    PreparedStaticTree(PreparedStaticTree&&) noexcept   = default;
+    PreparedStaticTree& operator=(PreparedStaticTree&&) = delete;
+
+    ~PreparedStaticTree() { teardown_static(tree_, states_.get()); }
+
+    State operator()() { return execute_step_static<Variant, Tree>(tree_, states_.get(), params_); }
+    State operator()(size_t& _steps) {
+      return execute_steps_static<Variant, Tree>(tree_, states_.get(), params_, _steps);
+    }
+
+    StaticTreeState<Variant, Tree> tree_;
+    std::reference_wrapper<StateProvider> states_;
+    Params params_;
+  };  // PreparedStaticTree
+
+  // prepares the execution of a tree compiled with compile_static
+  // the active task lives inside the callable, moving it moves the task. it must not be copied
+  template <class Variant, auto Tree, class StateProvider, class... Ts>
+  [[nodiscard]] auto prepare_static(StateProvider& _states, Ts... _ts) {
+    check_bindings<Variant, Tree, std::tuple<Ts...>>();
+    return PreparedStaticTree<Variant, Tree, StateProvider, std::tuple<Ts...>>(_states,
+                                                                              std::make_tuple(std::move(_ts)...));
+  }  // prepare_static
+
+  // prepares a tree compiled with compile_static for the dynamic engine. the parameters are checked at compile time
+  template <class Variant, auto Tree, class StateProvider, class... Ts>
+  [[nodiscard]] auto prepare_compiled(StateProvider& _states, Ts... _ts) {
+    check_bindings<Variant, Tree, std::tuple<Ts...>>();
+    return prepare<Variant>(Tree, _states, std::move(_ts)...);
+  }  // prepare_compiled
+
+}  // namespace TBT::Execute
\ No newline at end of file
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <TBT/defines.hpp>
+#include <memory>
+
+namespace TBT {
+
+  /*
+    Move-only replacement for std::function.
+      > callables up to Capacity bytes are stored inline, larger ones are allocated through the Allocator
+      > move-only callables (e.g. capturing a std::unique_ptr) are accepted
+      > moving an inline callable moves the callable itself. prepared trees must only be moved before they run
+  */
+
+  template <class Signature, size_t Capacity = TBT_INLINE_TREE_SIZE, class Allocator = std::allocator<std::byte>>
+  struct InplaceFunction;
+
+  template <class R, class... Args, size_t Capacity, class Allocator>
+  struct InplaceFunction<R(Args...), Capacity, Allocator> {
+    static_assert(Capacity >= sizeof(void*), "the storage must at least hold a pointer");
+
+    struct VTable {
+      R (*invoke_)(InplaceFunction&, Args&&...);
+      void (*move_)(InplaceFunction& _dst, InplaceFunction& _src) noexcept;
+      void (*destroy_)(InplaceFunction&) noexcept;
+      bool inline_;
+    };  // VTable
+
+    template <class F>
+    static constexpr bool fits_inline = sizeof(F) <= Capacity && alignof(F) <= alignof(std::max_align_t) &&
+                                        std::is_nothrow_move_constructible_v<F>;
+
+    template <class F>
+    using FAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<F>;
+
+    InplaceFunction() = default;
+    InplaceFunction(std::nullptr_t) {}
+    explicit InplaceFunction(const Allocator& _alloc) : alloc_(_alloc) {}
+
+    template <class F>
+      requires(!std::same_as<std::decay_t<F>, InplaceFunction> && std::is_invocable_r_v<R, std::decay_t<F>&, Args...>)
+    InplaceFunction(F&& _f, const Allocator& _alloc = Allocator()) : alloc_(_alloc) {
+      using T = std::decay_t<F>;
+      if constexpr (fits_inline<T>) {
+        ::new (storage_) T(std::forward<F>(_f));
+      } else {
+        FAllocator<T> a(alloc_);
+        T* ptr = std::allocator_traits<FAllocator<T>>::allocate(a, 1);
+        try {
+          std::allocator_traits<FAllocator<T>>::construct(a, ptr, std::forward<F>(_f));
+        } catch (...) {
+          std::allocator_traits<FAllocator<T>>::deallocate(a, ptr, 1);
+          throw;
+        }
+        ::new (storage_) T*(ptr);
+      }
+      vtable_ = &vtable_for<T>;
+    }
+
+    InplaceFunction(InplaceFunction&& _other) noexcept : alloc_(std::move(_other.alloc_)) { take(_other); }
+
+    InplaceFunction& operator=(InplaceFunction&& _other) noexcept {
+      if (this != &_other) {
+        reset();
+        alloc_ = std::move(_other.alloc_);
+        take(_other);
+      }
+      return *this;
+    }
+
+    template <class F>
+      requires(!std::same_as<std::decay_t<F>, InplaceFunction> && std::is_invocable_r_v<R, std::decay_t<F>&, Args...>)
+    InplaceFunction& operator=(F&& _f) {
+      return *this = InplaceFunction(std::forward<F>(_f), alloc_);
+    }
+
+    InplaceFunction& operator=(std::nullptr_t) noexcept {
+      reset();
+      return *this;
+    }
+
+    InplaceFunction(const InplaceFunction&)            = delete;
+    InplaceFunction& operator=(const InplaceFunction&) = delete;
+
+    ~InplaceFunction() { reset(); }
+
+    R operator()(Args... _args) {
+      assert(vtable_ != nullptr);
+      return vtable_->invoke_(*this, std::forward<Args>(_args)...);
+    }
+
+    explicit operator bool() const noexcept { return vtable_ != nullptr; }
+
+    // true if the callable is stored inside this object
+    [[nodiscard]] bool is_inline() const noexcept { return vtable_ && vtable_->inline_; }
+
+    void reset() noexcept {
+      if (vtable_) vtable_->destroy_(*this);
+      vtable_ = nullptr;
+    }  // reset
+
+    template <class F>
+    static F* target(InplaceFunction& _f) noexcept {
+      if constexpr (fits_inline<F>)
+        return std::launder(reinterpret_cast<F*>(_f.storage_));
+      else
+        return *std::launder(reinterpret_cast<F**>(_f.storage_));
+    }  // target
+
+    template <class F>
+    static constexpr VTable vtable_for = {
+        [](InplaceFunction& _f, Args&&... _args) -> R {
+          return std::invoke(*target<F>(_f), std::forward<Args>(_args)...);
+        },
+        [](InplaceFunction& _dst, InplaceFunction& _src) noexcept {
+          if constexpr (fits_inline<F>) {
+            ::new (_dst.storage_) F(std::move(*target<F>(_src)));
+            std::destroy_at(target<F>(_src));
+          } else {
+            ::new (_dst.storage_) F*(target<F>(_src));
+          }
+        },
+        [](InplaceFunction& _f) noexcept {
+          if constexpr (fits_inline<F>) {
+            std::destroy_at(target<F>(_f));
+          } else {
+            FAllocator<F> a(_f.alloc_);
+            std::allocator_traits<FAllocator<F>>::destroy(a, target<F>(_f));
+            std::allocator_traits<FAllocator<F>>::deallocate(a, target<F>(_f), 1);
+          }
+        },
+        fits_inline<F>};
+
+    void take(InplaceFunction& _other) noexcept {
+      vtable_ = _other.vtable_;
+      if (vtable_) vtable_->move_(*this, _other);
+      _other.vtable_ = nullptr;
+    }  // take
+
+    const VTable* vtable_ = nullptr;
+    [[no_unique_address]] Allocator alloc_;
+    alignas(std::max_align_t) std::byte storage_[Capacity];
+  };  // InplaceFunction
+
+}  // namespace TBT
\ No newline at end of file
@@ -1,11 +1,90 @@
 #pragma once
 
+#include <TBT/events.hpp>
 #include <TBT/execute.hpp>
+#include <TBT/execute_static.hpp>
+#include <TBT/function.hpp>
+#include <TBT/instances.hpp>
+#include <TBT/timers.hpp>
+#include <TBT/workers.hpp>
 
 namespace TBT {
 
   enum ExecutionMode { STEPWISE_1, STEPWISE_INF, FULL_1, FULL_INF };
 
+  // how far a queued tree may advance per frame. 0 keeps the default of the mode: one step for STEPWISE_*, until the
+  // tree is done or waits for FULL_*. whichever limit is reached first ends the tree's turn, one step is always made
+  struct Quota {
+    uint32_t steps_ = 0;
+    std::chrono::microseconds time_{0};
+  };  // Quota
+
+  // a prepared tree. move-only, stored inline up to TBT_INLINE_TREE_SIZE bytes
+  // called with the number of nodes it may visit, set to the nodes it visited. see Execute::execute_steps
+  using TreeFunction = InplaceFunction<State(size_t&), TBT_INLINE_TREE_SIZE, TBT_TREE_ALLOCATOR>;
+
+  /*
+    Completion signal of a queued tree.
+      > lock-free. written once by the thread executing the queue, read by the handle from any thread
+      > lives inside the ExecutionItem. the item is kept in the queue until the handle was released
+  */
+
+  struct Completion {
+    static constexpr uint32_t pending = std::numeric_limits<uint32_t>::max();
+
+    std::atomic<uint32_t> result_     = pending;
+    std::atomic<bool> released_       = false;  // no handle refers to the item anymore
+
+    Completion()                      = default;
+
+    // only valid as long as no handle refers to the item
+    Completion(Completion&& _other) noexcept
+        : result_(_other.result_.load(std::memory_order_relaxed)),
+          released_(_other.released_.load(std::memory_order_relaxed)) {}
+
+    Completion& operator=(Completion&& _other) noexcept {
+      result_.store(_other.result_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      released_.store(_other.released_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      return *this;
+    }
+
+    void set(const State _res) noexcept {
+      result_.store(_res, std::memory_order_release);
+      result_.notify_all();
+    }  // set
+
+    [[nodiscard]] bool ready() const noexcept { return result_.load(std::memory_order_acquire) != pending; }
+
+    [[nodiscard]] State get() const noexcept {
+      assert(ready());
+      return static_cast<State>(result_.load(std::memory_order_acquire));
+    }  // get
+
+    // blocks the calling thread until the tree has finished
+    State wait() const noexcept {
+      uint32_t res;
+      while ((res = result_.load(std::memory_order_acquire)) == pending)
+        result_.wait(pending, std::memory_order_acquire);
+      return static_cast<State>(res);
+    }  // wait
+
+  };  // Completion
+
+  /*
+    Weak handle to a queued tree: the index of its slot and the generation of the slot.
+      > the generation is odd while the slot holds an item and changes whenever the item is dropped
+      > TaskQueue::get() checks it in O(1). a stale or forged handle yields nullptr instead of another tree
+      > it does not keep the item alive, unlike TreeAwaitable. copy it around freely
+  */
+  struct TreeHandle {
+    static constexpr uint32_t invalid = std::numeric_limits<uint32_t>::max();
+
+    uint32_t index_      = invalid;
+    uint32_t generation_ = 0;
+
+    friend bool operator==(const TreeHandle&, const TreeHandle&) = default;
+  };  // TreeHandle
+
   struct ExecutionItem {
     ExecutionItem()                                = default;
 
@@ -18,105 +97,670 @@ namespace TBT {
     // std::shared_ptr<Execute::CoStateState> values_;
     int32_t priority_                              = 0;
     ExecutionMode mode_;
-    std::function<TBT::State()> tree_;
-    std::promise<TBT::State> promise_;
-    std::shared_ptr<Execute::CoStateValues> values_;
+    TreeFunction tree_;
+    Completion completion_;
+    Execute::CoStateValues* values_                = nullptr;  // the coroutine awaiting the tree, if any
     size_t last_update_;
+    bool main_thread_only_                         = false;  // never handed to another worker
+    bool cancel_                                   = false;  // cancelled while its tree was on the stack
+    bool stepping_                                 = false;  // its tree is on the stack, see cancel
+    bool inline_                                   = false;  // stepped by the coroutine awaiting it, see step_inline
+    TreeHandle handle_;
+    Quota quota_;
+    Execute::Parking parking_;
   };  // ExecutionItem
 
+  /*
+    Cancels a queued tree.
+      > the active task is unwound at once: its coroutine frame is destroyed, exit is called and the state released
+      > timers and event subscriptions of the tree go with it. the completion reports CANCELLED
+      > a coroutine awaiting the tree is resumed. trees awaited by the cancelled one keep running
+      > the item leaves the queue when the queue reaches it next, it is not searched for
+      > called while the tree is on the stack, from inside the tree itself or from a tree it steps inline, the tree is
+        unwound as soon as the current task returns
+      > call it on the thread executing the queue, between frames or from a task. not during a parallel frame
+  */
+  inline void cancel(ExecutionItem& _item) {
+    if (_item.completion_.ready()) return;
+    // the tree stops after the current node, like an awaiting one
+    if (_item.stepping_) {
+      _item.cancel_ = true;
+      _item.parking_.state_.store(Execute::Parking::AWAITING, std::memory_order_relaxed);
+      return;
+    }
+
+    if (_item.parking_.timers_) _item.parking_.timers_->cancel(_item.parking_.timer_);
+    _item.tree_ = nullptr;
+    _item.completion_.set(CANCELLED);
+    if (_item.values_) _item.values_->set_done();
+    // a parked item comes back through the wake list and is dropped there
+    _item.parking_.unpark();
+  }  // cancel
+
+  struct Budget;
+
+  namespace detail {
+    // the budget of the frame executed on this thread, if any
+    inline thread_local Budget* current_budget_ = nullptr;
+
+    bool step_inline(ExecutionItem& _item);
+  }  // namespace detail
+
+  // items never move while they are queued
   template <class Allocator = std::allocator<ExecutionItem>>
-  using TreeRef = typename std::list<ExecutionItem, Allocator>::iterator;
+  using TreeRef = ExecutionItem*;
 
+  // handle to a queued tree. can be co_awaited, polled with done() or waited on with wait()
   template <class T, class Allocator = std::allocator<T>>
   struct TreeAwaitable {
-    std::future<TBT::State> future_;
     TreeRef<Allocator> ref_;
+    bool owns_ = false;
+
+    TreeAwaitable() = default;
+    explicit TreeAwaitable(TreeRef<Allocator> _ref) : ref_(_ref), owns_(true) {}
 
-    bool await_ready() noexcept {
-      return false;  //
+    TreeAwaitable(TreeAwaitable&& _other) noexcept : ref_(_other.ref_), owns_(std::exchange(_other.owns_, false)) {}
+    TreeAwaitable& operator=(TreeAwaitable&& _other) noexcept {
+      if (this != &_other) {
+        release();
+        ref_  = _other.ref_;
+        owns_ = std::exchange(_other.owns_, false);
+      }
+      return *this;
     }
 
+    TreeAwaitable(const TreeAwaitable&)            = delete;
+    TreeAwaitable& operator=(const TreeAwaitable&) = delete;
+
+    ~TreeAwaitable() { release(); }
+
+    // the queue drops the item once the tree has finished
+    // a coroutine destroyed while awaiting the tree detaches itself here, so the item never signals a dead frame
+    void release() noexcept {
+      if (owns_) {
+        if (ref_->values_) ref_->values_ = nullptr;
+        ref_->completion_.released_.store(true, std::memory_order_release);
+      }
+      owns_ = false;
+    }  // release
+
+    [[nodiscard]] bool done() const noexcept { return ref_->completion_.ready(); }
+
+    // changes how far the tree advances per frame. call it between frames or from the thread executing the queue
+    void set_quota(const Quota _quota) noexcept { ref_->quota_ = _quota; }
+
+    // see TBT::cancel
+    void cancel() { TBT::cancel(*ref_); }
+
+    // a weak handle that stays safe to use after this one is gone, see TreeHandle
+    [[nodiscard]] TreeHandle handle() const noexcept { return ref_->handle_; }
+
+    State wait() const noexcept { return ref_->completion_.wait(); }
+
+    // an inline tree gets its steps right here. the coroutine does not suspend if it finishes
+    bool await_ready() { return done() || (ref_->inline_ && detail::step_inline(*ref_)); }
+
     void await_suspend(const std::coroutine_handle<Execute::CoState::promise_type>&) {}
-    State await_resume() noexcept { return future_.get(); }
+    State await_resume() noexcept { return ref_->completion_.get(); }
 
   };  // TreeAwaitable
 
+  /*
+    Limit of one TaskQueue::execute(Budget&). the frame ends with the first limit that is reached
+      > steps_ counts visited nodes of prepared trees. FULL_* items are interrupted inside their tree and continue next
+        frame
+      > every frame makes at least one step, even if the deadline has already passed
+      > items that did not get their step go first within their priority in the next frame
+      > an item skipped for more than max_age_ frames runs before all others, so low priorities never starve
+      > frames spent parked or asleep are not skipped frames. a woken item ages from the frame it wakes up in
+  */
+  struct Budget {
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point deadline_ = Clock::time_point::max();
+    size_t steps_               = std::numeric_limits<size_t>::max();
+    size_t max_age_             = 8;
+
+    // filled by the last execute
+    size_t used_steps_          = 0;
+    Clock::duration used_time_{};
+    size_t deferred_ = 0;  // items that waited for a step and did not get one
+
+    // true once a limit is reached
+    [[nodiscard]] bool exhausted() const noexcept {
+      if (used_steps_ == 0) return false;
+      return used_steps_ >= steps_ || (deadline_ != Clock::time_point::max() && Clock::now() >= deadline_);
+    }  // exhausted
+
+    // how many of _steps nodes a tree may visit in one call. with a deadline the clock is read after every node
+    [[nodiscard]] size_t allowance(const size_t _steps) const noexcept {
+      if (deadline_ != Clock::time_point::max()) return 1;
+      return used_steps_ < steps_ ? std::min(_steps, steps_ - used_steps_) : 1;
+    }  // allowance
+  };  // Budget
+
+  // a tree submitted from any thread. it waits in the inbox of the queue until the next frame, see TaskQueue::submit
+  struct Submission {
+    Submission* next_      = nullptr;
+    uint64_t ticket_       = 0;
+    int32_t priority_      = 0;
+    ExecutionMode mode_    = STEPWISE_1;
+    bool main_thread_only_ = false;
+    Quota quota_;
+    TreeFunction tree_;
+  };  // Submission
+
+  namespace detail {
+    // drained Submissions this thread reuses. queues hand them back in batches, any queue can take any node
+    struct SubmissionCache {
+      ~SubmissionCache() {
+        while (head_) delete std::exchange(head_, head_->next_);
+      }
+
+      Submission* head_ = nullptr;
+    };  // SubmissionCache
+
+    inline thread_local SubmissionCache submission_cache_;
+  }  // namespace detail
+
+  /*
+    Awaited trees that run on the stack of the awaiting coroutine, queued with TBT_RUN_INLINE.
+      > co_await steps the tree at once, like FULL_1 but limited by its quota and the budget of the frame
+      > if it finishes, the coroutine continues in the same step. a chain of nested awaited trees takes no frame
+      > if it waits or runs out of steps, the coroutine suspends and the tree continues in the queue from the next
+        frame on, as any other awaited tree
+      > only STEPWISE_1 and FULL_1 trees are stepped inline. co_await the handle right away, in a parallel frame a
+        tree queued earlier may be executed by another worker at the same time
+  */
+  inline bool detail::step_inline(ExecutionItem& _item) {
+    if (_item.mode_ != STEPWISE_1 && _item.mode_ != FULL_1) return false;
+
+    Execute::Parking& parking     = _item.parking_;
+    Execute::Parking* const outer = std::exchange(Execute::detail::current_parking_, &parking);
+    Budget* const budget          = current_budget_;
+    const size_t limit            = _item.quota_.steps_ ? _item.quota_.steps_ : SIZE_MAX;
+
+    State r         = BUSY;
+    size_t n        = 0;
+    _item.stepping_ = true;
+    while (n < limit && !(budget && budget->exhausted())) {
+      size_t steps = budget ? budget->allowance(limit - n) : limit - n;
+      if (budget) budget->used_steps_++;
+      parking.waiting_ = false;
+      r                = _item.tree_(steps);
+      n += steps;
+      if (budget) budget->used_steps_ += steps - 1;
+      if (r != BUSY || _item.cancel_ || parking.waiting_ ||
+          parking.state_.load(std::memory_order_relaxed) == Execute::Parking::AWAITING)
+        break;
+    }
+    _item.stepping_                   = false;
+    Execute::detail::current_parking_ = outer;
+
+    // the awaiting coroutine is still running, it must not be signalled
+    if (_item.cancel_) {
+      _item.values_ = nullptr;
+      cancel(_item);
+      return true;
+    }
+    if (r == BUSY) return false;
+    _item.completion_.set(r);
+    _item.values_ = nullptr;
+    _item.tree_   = nullptr;
+    return true;
+  }  // step_inline
+
   /*
     The TaskQueue needs fullfill multiple requirements:
       > removing items without changing the order
       > removing items while iterating
-      > sorteable
+      > ordered by priority, stable within a priority
       > the items shouldnt be copied around. the lambdas are potentially very heavy
       > memory fragmentation and pointer chasing can be adressed using an allocator
+
+    Items live in chunks that are never moved or freed while the queue exists, so handles stay valid. A slot is
+    reused once its item was dropped, a TreeHandle tells whether it still refers to the same tree. Every priority
+    has its own bucket holding the items in submission order. Inserting is O(1), no sorting is needed.
+
+    execute(Budget&) runs the items in the same order as execute() until the budget is used up, see Budget.
+
+    execute(WorkerPool&) runs the trees of a frame in parallel:
+      > the items are dealt round-robin in priority order to the workers. idle workers steal from the others
+      > priorities are a hint only. trees of different priorities can run at the same time
+      > main_thread_only_ items are executed by the calling thread before it starts helping the others
+      > a tree never runs on two workers at once, but it can move to another worker between frames
+      > tasks of different trees share the StateProvider. everything they touch there must be thread-safe or
+        per-worker (WorkerLocal). a task_pool_ inside the StateProvider is not thread-safe, leave it out
+      > trees can be added from any worker while a frame is running
+
+    emplace() must only be called from the thread executing the queue, or from a task during a parallel frame. Other
+    threads use submit(). It pushes onto a lock-free stack, the inbox, which every execute drains before the frame
+    starts. The trees of one drain are added in ticket order, tickets are handed out in submission order.
+
+    A tree whose coroutine waits on an awaitable is parked after its step and costs nothing until set_done() is
+    called. It is put back at the end of its bucket at the start of the next frame. See Execute::Parking.
+    Sleeping trees (timers.hpp) are parked the same way and woken by the timer wheels of the queue.
   */
 
   template <class Allocator = std::allocator<ExecutionItem>>
   struct TaskQueue {
-    std::list<ExecutionItem, Allocator> q_;
-    bool dirty_       = true;
+    using ItemAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<ExecutionItem>;
+    using ItemTraits                   = std::allocator_traits<ItemAllocator>;
+
+    static constexpr size_t chunk_size = 64;
+
+    TaskQueue()                        = default;
+    explicit TaskQueue(const Allocator& _alloc) : alloc_(_alloc) {}
+
+    TaskQueue(const TaskQueue&)            = delete;
+    TaskQueue& operator=(const TaskQueue&) = delete;
+
+    ~TaskQueue() {
+      for (Submission* s = inbox_.exchange(nullptr, std::memory_order_acquire); s;) delete std::exchange(s, s->next_);
+      for (Submission* s = recycled_.exchange(nullptr, std::memory_order_acquire); s;)
+        delete std::exchange(s, s->next_);
+      for (auto& [priority, items] : buckets_)
+        for (ExecutionItem* item : items) std::destroy_at(item);
+      for (ExecutionItem* item : parked_) std::destroy_at(item);
+      for (ExecutionItem* chunk : chunks_) ItemTraits::deallocate(alloc_, chunk, chunk_size);
+    }
+
+    // a new item in the bucket of _priority. it is executed from the next frame on
+    ExecutionItem& emplace(const int32_t _priority) {
+      std::unique_lock lock(mutex_, std::defer_lock);
+      if (parallel_) lock.lock();
+
+      if (free_.empty()) {
+        chunks_.push_back(ItemTraits::allocate(alloc_, chunk_size));
+        const uint32_t first = static_cast<uint32_t>(generations_.size());
+        generations_.resize(generations_.size() + chunk_size, 0);
+        for (uint32_t i = chunk_size; i > 0; --i) free_.push_back(first + i - 1);
+      }
+      const uint32_t slot = free_.back();
+      free_.pop_back();
+      ExecutionItem* item  = ::new (at(slot)) ExecutionItem();
+      item->handle_        = {slot, ++generations_[slot]};
+      item->priority_      = _priority;
+      item->last_update_   = cur_frame_;
+      item->parking_.list_   = &wake_;
+      item->parking_.timers_ = &timers_;
+      item->parking_.item_   = item;
+      buckets_[_priority].push_back(item);
+      size_++;
+      return *item;
+    }  // emplace
+
+    // queues a prepared tree from any thread without locking. the tree is added at the start of the next frame and runs
+    // in it. nobody holds a handle to it, it is dropped once it is done. returns the ticket of the tree
+    uint64_t submit(const int32_t _priority, const ExecutionMode _mode, TreeFunction _tree, const Quota _quota = {},
+                    const bool _main_thread_only = false) {
+      // nodes are reused, the allocator is only hit while the cache warms up
+      Submission*& cache = detail::submission_cache_.head_;
+      if (!cache) cache = recycled_.exchange(nullptr, std::memory_order_acquire);
+      Submission* s        = cache ? std::exchange(cache, cache->next_) : new Submission();
+      s->ticket_           = tickets_.fetch_add(1, std::memory_order_relaxed);
+      s->priority_         = _priority;
+      s->mode_             = _mode;
+      s->main_thread_only_ = _main_thread_only;
+      s->quota_            = _quota;
+      s->tree_             = std::move(_tree);
+
+      Submission* head = inbox_.load(std::memory_order_relaxed);
+      do {
+        s->next_ = head;
+      } while (!inbox_.compare_exchange_weak(head, s, std::memory_order_release, std::memory_order_relaxed));
+      return s->ticket_;
+    }  // submit
+
+    // adds the trees submitted since the last frame, in ticket order
+    void drain() {
+      Submission* s = inbox_.exchange(nullptr, std::memory_order_acquire);
+      if (!s) return;
+      for (; s; s = s->next_) inbox_buffer_.push_back(s);
+
+      // the stack holds them newest first. tickets and pushes only disagree if producers raced
+      const auto by_ticket = [](const Submission* _a, const Submission* _b) { return _a->ticket_ < _b->ticket_; };
+      std::reverse(inbox_buffer_.begin(), inbox_buffer_.end());
+      if (!std::is_sorted(inbox_buffer_.begin(), inbox_buffer_.end(), by_ticket))
+        std::sort(inbox_buffer_.begin(), inbox_buffer_.end(), by_ticket);
+
+      for (Submission* sub : inbox_buffer_) {
+        ExecutionItem& item    = emplace(sub->priority_);
+        item.mode_             = sub->mode_;
+        item.main_thread_only_ = sub->main_thread_only_;
+        item.quota_            = sub->quota_;
+        item.tree_             = std::move(sub->tree_);
+        item.completion_.released_.store(true, std::memory_order_relaxed);
+      }
+
+      // back to the producers in one go
+      for (size_t i = 0; i + 1 < inbox_buffer_.size(); ++i) inbox_buffer_[i]->next_ = inbox_buffer_[i + 1];
+      Submission* last = inbox_buffer_.back();
+      Submission* head = recycled_.load(std::memory_order_relaxed);
+      do {
+        last->next_ = head;
+      } while (!recycled_.compare_exchange_weak(head, inbox_buffer_.front(), std::memory_order_release,
+                                                std::memory_order_relaxed));
+      inbox_buffer_.clear();
+    }  // drain
+
+    // runs every item once, highest priority first
+    void execute() {
+      drain();
+      cur_frame_++;
+      timers_.advance(cur_frame_);
+      wake();
+      for (auto& [priority, items] : buckets_) {
+        // items can be added while iterating. they are skipped in this frame
+        size_t w = 0;
+        for (size_t r = 0; r < items.size(); ++r) {
+          ExecutionItem* item = items[r];
+          if (step(*item))
+            items[w++] = item;
+          else if (!item->parking_.parked_)
+            drop(item);
+        }
+        items.resize(w);
+      }
+    }  // execute
+
+    // runs the items in priority order until _budget is used up. see Budget
+    void execute(Budget& _budget) {
+      const auto start = Budget::Clock::now();
+      drain();
+      cur_frame_++;
+      timers_.advance(cur_frame_);
+      wake();
+
+      _budget.used_steps_ = 0;
+      _budget.deferred_   = 0;
+
+      // starving items first, wherever they are in their bucket. the order of the others is kept
+      for (auto& [priority, items] : buckets_) {
+        size_t w = 0;
+        for (size_t r = 0; r < items.size(); ++r) {
+          ExecutionItem* item = items[r];
+          if (_budget.exhausted() || cur_frame_ - item->last_update_ <= _budget.max_age_ || step(*item, &_budget))
+            items[w++] = item;
+          else if (!item->parking_.parked_)
+            drop(item);
+        }
+        items.resize(w);
+      }
+
+      for (auto& [priority, items] : buckets_) {
+        size_t w = 0;
+        size_t r = 0;
+        for (; r < items.size() && !_budget.exhausted(); ++r) {
+          ExecutionItem* item = items[r];
+          if (step(*item, &_budget))
+            items[w++] = item;
+          else if (!item->parking_.parked_)
+            drop(item);
+        }
+
+        // the items not reached move to the front of the bucket
+        for (size_t i = r; i < items.size(); ++i)
+          if (items[i]->last_update_ != cur_frame_ && !items[i]->completion_.ready()) _budget.deferred_++;
+        items.erase(items.begin() + w, items.begin() + r);
+        std::rotate(items.begin(), items.begin() + w, items.end());
+      }
+      _budget.used_time_ = Budget::Clock::now() - start;
+    }  // execute
+
+    // range of a worker packed into {begin, end}. the owner takes from the front, thieves from the back
+    struct alignas(64) Lane {
+      std::atomic<uint64_t> range_ = 0;
+    };  // Lane
+
+    static constexpr uint64_t pack(const uint32_t _begin, const uint32_t _end) {
+      return (static_cast<uint64_t>(_begin) << 32) | _end;
+    }  // pack
+
+    // takes one index of the lane. from the front for the owner, from the back for thieves
+    static bool take(Lane& _lane, const bool _front, uint32_t& _out) noexcept {
+      uint64_t r = _lane.range_.load(std::memory_order_acquire);
+      while (true) {
+        const uint32_t b = static_cast<uint32_t>(r >> 32);
+        const uint32_t e = static_cast<uint32_t>(r);
+        if (b >= e) return false;
+        const uint64_t n = _front ? pack(b + 1, e) : pack(b, e - 1);
+        if (_lane.range_.compare_exchange_weak(r, n, std::memory_order_acq_rel, std::memory_order_acquire)) {
+          _out = _front ? b : e - 1;
+          return true;
+        }
+      }
+    }  // take
+
+    // runs every item once on the workers of _pool. see above for the contract
+    void execute(WorkerPool& _pool) {
+      const uint32_t workers = _pool.size();
+      if (workers == 1) return execute();
+
+      drain();
+      cur_frame_++;
+      timers_.advance(cur_frame_);
+      wake();
+      frame_.clear();
+      main_.clear();
+      for (auto& [priority, items] : buckets_)
+        for (ExecutionItem* item : items) (item->main_thread_only_ ? main_ : frame_).push_back(item);
+
+      if (lane_count_ < workers) {
+        lanes_      = std::make_unique<Lane[]>(workers);
+        lane_count_ = workers;
+      }
+      // worker w owns frame_[w], frame_[w + workers], ...
+      const uint32_t n = static_cast<uint32_t>(frame_.size());
+      for (uint32_t w = 0; w < workers; ++w)
+        lanes_[w].range_.store(pack(0, w < n ? (n - w + workers - 1) / workers : 0), std::memory_order_relaxed);
+
+      auto job = [&](const uint32_t _w) {
+        if (_w == 0)
+          for (ExecutionItem* item : main_) step(*item);
+
+        uint32_t k;
+        while (take(lanes_[_w], true, k)) step(*frame_[_w + k * workers]);
+        for (uint32_t v = 1; v < workers; ++v) {
+          const uint32_t victim = (_w + v) % workers;
+          while (take(lanes_[victim], false, k)) step(*frame_[victim + k * workers]);
+        }
+      };
+
+      parallel_ = true;
+      _pool.run(job);
+      parallel_ = false;
+
+      // same rule as in step(). finished items without a handle are dropped, parked ones leave the bucket
+      for (auto& [priority, items] : buckets_) {
+        size_t w = 0;
+        for (ExecutionItem* item : items) {
+          if (item->parking_.parked_) continue;
+          if (item->completion_.ready() && item->completion_.released_.load(std::memory_order_acquire)) {
+            drop(item);
+          } else {
+            items[w++] = item;
+          }
+        }
+        items.resize(w);
+      }
+    }  // execute
+
+    // items are counted until they are dropped, parked ones included
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+    [[nodiscard]] size_t parked() const noexcept { return parked_.size(); }
+    [[nodiscard]] size_t sleeping() const noexcept { return timers_.size(); }
+
+    // executes the item according to its mode. false if the item leaves its bucket, dropped or parked
+    // every call of the tree is charged to _budget, FULL_* modes stop once it is used up
+    bool step(ExecutionItem& _item, Budget* _budget = nullptr) {
+      // finished trees wait for their handle to be released
+      if (_item.completion_.ready()) return !_item.completion_.released_.load(std::memory_order_acquire);
+      if (_item.last_update_ == cur_frame_) return true;
+      _item.last_update_            = cur_frame_;
+
+      Execute::Parking& parking     = _item.parking_;
+      Execute::Parking* const outer = std::exchange(Execute::detail::current_parking_, &parking);
+      Budget* const outer_budget    = std::exchange(detail::current_budget_, _budget);
+      const auto awaiting           = [&]() {
+        return parking.state_.load(std::memory_order_relaxed) == Execute::Parking::AWAITING;
+      };
+
+      // the mode sets the defaults, the quota narrows or widens them
+      const bool full     = _item.mode_ == FULL_1 || _item.mode_ == FULL_INF;
+      const size_t limit  = _item.quota_.steps_ ? _item.quota_.steps_ : (full ? SIZE_MAX : 1);
+      const bool sliced   = _item.quota_.time_.count() > 0;
+      const auto deadline = sliced ? std::chrono::steady_clock::now() + _item.quota_.time_
+                                   : std::chrono::steady_clock::time_point::max();
+      const auto stop     = [&](const size_t _n) {
+        return _n >= limit || awaiting() || (full && parking.waiting_) || _item.cancel_ ||
+               (_budget && _budget->exhausted()) || (sliced && std::chrono::steady_clock::now() >= deadline);
+      };
+
+      // a call runs node after node until a task waits, that ends FULL_* modes. a time slice reads the clock after
+      // every node
+      State r         = BUSY;
+      size_t n        = 0;
+      const auto tick = [&]() {
+        size_t steps  = sliced ? 1 : limit - n;
+        if (_budget) steps = _budget->allowance(steps);
+        // the first node is charged up front, inline trees awaited in it see it
+        if (_budget) _budget->used_steps_++;
+        parking.waiting_ = false;
+        const State s    = _item.tree_(steps);
+        n += steps;
+        if (_budget) _budget->used_steps_ += steps - 1;
+        return s;
+      };
+      _item.stepping_ = true;
+      while ((r = tick()) == BUSY && !stop(n)) {}
+      _item.stepping_ = false;
+      // the INF modes start over
+      if (_item.mode_ == STEPWISE_INF || _item.mode_ == FULL_INF) r = BUSY;
+      Execute::detail::current_parking_ = outer;
+      detail::current_budget_           = outer_budget;
+
+      if (_item.cancel_) {
+        TBT::cancel(_item);
+        return !_item.completion_.released_.load(std::memory_order_acquire);
+      }
+
+      if (r != BUSY) {
+        _item.completion_.set(r);
+        if (_item.values_) _item.values_->set_done();
+        _item.tree_ = nullptr;
+        return !_item.completion_.released_.load(std::memory_order_acquire);
+      }
+
+      // still waiting. a set_done() racing with this keeps the item active
+      uint32_t expected = Execute::Parking::AWAITING;
+      if (parking.state_.compare_exchange_strong(expected, Execute::Parking::PARKED, std::memory_order_acq_rel)) {
+        park(_item);
+        return false;
+      }
+      return true;
+    }  // step
+
+    // the slot of the item becomes free. handles to it turn stale
+    void drop(ExecutionItem* _item) {
+      const uint32_t slot = _item->handle_.index_;
+      std::destroy_at(_item);
+      generations_[slot]++;
+      free_.push_back(slot);
+      size_--;
+    }  // drop
+
+    [[nodiscard]] ExecutionItem* at(const uint32_t _slot) noexcept {
+      return chunks_[_slot / chunk_size] + _slot % chunk_size;
+    }  // at
+
+    // the item _h refers to or nullptr if it was dropped. call it on the thread executing the queue or between frames
+    [[nodiscard]] ExecutionItem* get(const TreeHandle _h) noexcept {
+      if (_h.index_ >= generations_.size()) return nullptr;
+      const uint32_t g = generations_[_h.index_];
+      return (g & 1) && g == _h.generation_ ? at(_h.index_) : nullptr;
+    }  // get
+
+    // cancels the tree _h refers to. false if it is gone already
+    bool cancel(const TreeHandle _h) {
+      ExecutionItem* item = get(_h);
+      if (item) TBT::cancel(*item);
+      return item != nullptr;
+    }  // cancel
+
+    void park(ExecutionItem& _item) {
+      std::unique_lock lock(mutex_, std::defer_lock);
+      if (parallel_) lock.lock();
+      _item.parking_.parked_ = true;
+      _item.parking_.index_  = static_cast<uint32_t>(parked_.size());
+      parked_.push_back(&_item);
+    }  // park
+
+    // puts the items woken since the last frame back into their buckets
+    void wake() {
+      for (Execute::Parking* p = wake_.take(); p;) {
+        Execute::Parking* next = p->next_;
+        ExecutionItem* last    = parked_.back();
+        parked_[p->index_]     = last;
+        last->parking_.index_  = p->index_;
+        parked_.pop_back();
+        p->parked_ = false;
+        // it waited for an event, not for a step. its age starts over as if it had run in the last frame
+        p->item_->last_update_ = cur_frame_ - 1;
+        buckets_[p->item_->priority_].push_back(p->item_);
+        p = next;
+      }
+    }  // wake
+
+    std::map<int32_t, std::vector<ExecutionItem*>, std::greater<int32_t>> buckets_;
+    std::vector<ExecutionItem*> chunks_;
+    std::vector<uint32_t> generations_;  // one per slot, odd while the slot is used
+    std::vector<uint32_t> free_;
+    std::vector<ExecutionItem*> parked_;
+    Execute::WakeList wake_;
+    Timers timers_;
+    [[no_unique_address]] ItemAllocator alloc_;
+    size_t size_      = 0;
     size_t cur_frame_ = 0;
+
+    // submissions from other threads
+    std::atomic<Submission*> inbox_    = nullptr;
+    std::atomic<Submission*> recycled_ = nullptr;
+    std::atomic<uint64_t> tickets_     = 0;
+    std::vector<Submission*> inbox_buffer_;
+
+    // parallel execution
+    std::vector<ExecutionItem*> frame_;
+    std::vector<ExecutionItem*> main_;
+    std::unique_ptr<Lane[]> lanes_;
+    uint32_t lane_count_ = 0;
+    std::mutex mutex_;
+    bool parallel_ = false;
   };  // TaskQueue
 
-#define TBT_EXECUTE_QUEUE(state_provider)                                                  \
-  state_provider.tasks_queue_.cur_frame_++;                                                \
-  if (!state_provider.tasks_queue_.q_.empty()) {                                           \
-    if (state_provider.tasks_queue_.dirty_) {                                              \
-      state_provider.tasks_queue_.dirty_ = false;                                          \
-      state_provider.tasks_queue_.q_.sort(                                                 \
-          [](const auto& _v1, const auto& _v2) { return _v1.priority_ > _v2.priority_; }); \
-    }                                                                                      \
-    auto& queue = state_provider.tasks_queue_.q_;                                          \
-    for (auto curr = queue.begin(); curr != queue.end();) {                                \
-      TBT::ExecutionItem& item = *curr;                                                    \
-      if (item.last_update_ == state_provider.tasks_queue_.cur_frame_) {                   \
-        ++curr;                                                                            \
-        continue;                                                                          \
-      }                                                                                    \
-      item.last_update_ = state_provider.tasks_queue_.cur_frame_;                          \
-      bool erased       = false;                                                           \
-      switch (item.mode_) {                                                                \
-        case TBT::STEPWISE_1: {                                                            \
-          TBT::State r = item.tree_();                                                     \
-          if (r != TBT::BUSY) {                                                            \
-            item.promise_.set_value(r);                                                    \
-            if (item.values_) item.values_->set_done();                                    \
-            curr   = queue.erase(curr);                                                    \
-            erased = true;                                                                 \
-          }                                                                                \
-          break;                                                                           \
-        }                                                                                  \
-        case TBT::STEPWISE_INF: {                                                          \
-          item.tree_();                                                                    \
-          break;                                                                           \
-        }                                                                                  \
-        case TBT::FULL_1: {                                                                \
-          TBT::State r = TBT::State::SUCCESS;                                              \
-          while ((r = item.tree_()) != TBT::BUSY) {}                                       \
-          item.promise_.set_value(r);                                                      \
-          if (item.values_) item.values_->set_done();                                      \
-          curr   = queue.erase(curr);                                                      \
-          erased = true;                                                                   \
-          break;                                                                           \
-        }                                                                                  \
-        case TBT::FULL_INF: {                                                              \
-          while ((item.tree_()) != TBT::BUSY) {}                                           \
-          break;                                                                           \
-        }                                                                                  \
-      }                                                                                    \
-      if (!erased) ++curr;                                                                 \
-      if (curr == queue.end()) break;                                                      \
-    }                                                                                      \
-  }
+#define TBT_EXECUTE_QUEUE(state_provider) state_provider.tasks_queue_.execute();
+#define TBT_EXECUTE_QUEUE_PARALLEL(state_provider, pool) state_provider.tasks_queue_.execute(pool);
+#define TBT_EXECUTE_QUEUE_BUDGET(state_provider, budget) state_provider.tasks_queue_.execute(budget);
 
 #ifdef __INTELLISENSE__
-#define TBT_COMPILE_AND_PREPARE(...) []() -> std::function<State()> { return []() { return SUCCESS; }; }();
+#define TBT_COMPILE_AND_PREPARE(...) [](size_t&) { return SUCCESS; };
+#define TBT_COMPILE_AND_PREPARE_STATIC(...) [](size_t&) { return SUCCESS; };
 #else
-#define TBT_COMPILE_AND_PREPARE(tree, states, ...)                                                    \
-  TBT::Execute::prepare<typename std::decay_t<decltype(states)>::Variant>(                            \
-      TBT::Compiler::compile_static<                                                                  \
-          TBT::Compiler::compute_size_static<typename std::decay_t<decltype(states)>::Variant>(tree), \
-          typename std::decay_t<decltype(states)>::Variant>(tree),                                    \
-      states __VA_OPT__(, ) __VA_ARGS__);
+#define TBT_COMPILE_AND_PREPARE(tree, states, ...)                                                        \
+  TBT::Execute::prepare_compiled<                                                                         \
+      typename std::decay_t<decltype(states)>::Variant,                                                   \
+      TBT::Compiler::compile_static<                                                                      \
+          TBT::Compiler::compute_size_static<typename std::decay_t<decltype(states)>::Variant>(tree),     \
+          typename std::decay_t<decltype(states)>::Variant>(tree)>(states __VA_OPT__(, ) __VA_ARGS__);
+
+// same as above but uses the statically specialized engine from execute_static.hpp
+#define TBT_COMPILE_AND_PREPARE_STATIC(tree, states, ...)                                                 \
+  TBT::Execute::prepare_static<                                                                           \
+      typename std::decay_t<decltype(states)>::Variant,                                                   \
+      TBT::Compiler::compile_static<                                                                      \
+          TBT::Compiler::compute_size_static<typename std::decay_t<decltype(states)>::Variant>(tree),     \
+          typename std::decay_t<decltype(states)>::Variant>(tree)>(states __VA_OPT__(, ) __VA_ARGS__);
 #endif
 
   // template <class Variant, class Tree, class StateProvider, class... Ts>
@@ -124,21 +768,49 @@ namespace TBT {
   //   return Execute::prepare<Variant>(compile_dynamic<Variant>(_tree), _states, std::forward<Ts>(_ts)...);
   // }  // d_compile_and_prepare
 
-#define TBT_RUN(priority, tree, state_provider, mode, ...)                                           \
-  [&]() -> auto {                                                                                    \
-    TBT::ExecutionItem item;                                                                         \
-    item.last_update_                  = state_provider.tasks_queue_.cur_frame_;                     \
-    item.priority_                     = priority;                                                   \
-    item.mode_                         = mode;                                                       \
-    item.tree_                         = TBT_COMPILE_AND_PREPARE(tree, state_provider, __VA_ARGS__); \
-    state_provider.tasks_queue_.dirty_ = true;                                                       \
-    std::future<TBT::State> f          = item.promise_.get_future();                                 \
-    state_provider.tasks_queue_.q_.push_back(std::move(item));                                       \
-    TBT::TreeAwaitable<TBT::ExecutionItem> out;                                                      \
-    out.future_ = std::move(f);                                                                      \
-    out.ref_    = std::prev(state_provider.tasks_queue_.q_.end());                                   \
-    return out;                                                                                      \
+// the prepared tree comes last, it can contain unparenthesized commas
+#define TBT_ENQUEUE_WITH(priority, state_provider, mode, main_thread_only, quota, ...) \
+  [&]() -> auto {                                                                      \
+    TBT::ExecutionItem& item = state_provider.tasks_queue_.emplace(priority);          \
+    item.mode_               = mode;                                                   \
+    item.main_thread_only_   = main_thread_only;                                       \
+    item.quota_              = quota;                                                  \
+    item.tree_               = __VA_ARGS__;                                            \
+    return TBT::TreeAwaitable<TBT::ExecutionItem>(&item);                              \
   }();
+#define TBT_ENQUEUE_ON(priority, state_provider, mode, main_thread_only, ...) \
+  TBT_ENQUEUE_WITH(priority, state_provider, mode, main_thread_only, TBT::Quota{}, __VA_ARGS__)
+#define TBT_ENQUEUE(priority, prepared, state_provider, mode) \
+  TBT_ENQUEUE_ON(priority, state_provider, mode, false, prepared)
+
+#define TBT_RUN(priority, tree, state_provider, mode, ...) \
+  TBT_ENQUEUE(priority, TBT_COMPILE_AND_PREPARE(tree, state_provider, __VA_ARGS__), state_provider, mode)
+#define TBT_RUN_STATIC(priority, tree, state_provider, mode, ...) \
+  TBT_ENQUEUE(priority, TBT_COMPILE_AND_PREPARE_STATIC(tree, state_provider, __VA_ARGS__), state_provider, mode)
+
+// the tree advances as far as the quota allows per frame. parenthesize a quota with more than one member
+#define TBT_RUN_SLICED(priority, tree, state_provider, mode, quota, ...) \
+  TBT_ENQUEUE_WITH(priority, state_provider, mode, false, quota,       \
+                   TBT_COMPILE_AND_PREPARE(tree, state_provider, __VA_ARGS__))
+
+// queues the tree from any thread. it joins the queue at the start of the next frame. returns its ticket
+#define TBT_SUBMIT(priority, tree, state_provider, mode, ...)                                \
+  [&]() -> uint64_t {                                                                        \
+    TBT::TreeFunction prepared = TBT_COMPILE_AND_PREPARE(tree, state_provider, __VA_ARGS__); \
+    return state_provider.tasks_queue_.submit(priority, mode, std::move(prepared));          \
+  }();
+
+// co_await it in a coroutine. the tree runs at once on the stack of the coroutine, see step_inline
+#define TBT_RUN_INLINE(priority, tree, state_provider, mode, ...)            \
+  [&]() -> auto {                                                            \
+    auto handle = TBT_RUN(priority, tree, state_provider, mode, __VA_ARGS__) \
+    handle.ref_->inline_ = true;                                             \
+    return handle;                                                           \
+  }();
+
+// the tree is only executed by the thread calling TBT_EXECUTE_QUEUE_PARALLEL
+#define TBT_RUN_MAIN_THREAD(priority, tree, state_provider, mode, ...) \
+  TBT_ENQUEUE_ON(priority, state_provider, mode, true, TBT_COMPILE_AND_PREPARE(tree, state_provider, __VA_ARGS__))
 
 #define TBT_RUN_STEPWISE_1(priority, tree, state_provider, ...) \
   TBT_RUN(priority, tree, state_provider, TBT::STEPWISE_1, __VA_ARGS__)
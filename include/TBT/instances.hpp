@@ -0,0 +1,463 @@
+#pragma once
+
+#include <TBT/execute.hpp>
+
+/*
+  Running one compiled tree for many entities.
+    > the Blueprint is the immutable part of a compiled tree: the node tables and a copy of the tree. it is shared
+    > TreeInstances keeps only the mutable part of every instance, one array per field (structure of arrays)
+    > an instance walks the tree like the static engine, the type of a node is resolved through a table at runtime
+    > tasks with a run_batch(std::span<Task>, StateProvider&, std::span<State>) overload are evaluated for all
+      instances entering them in the same step with a single call. run_batch replaces init, run and exit
+    > the parameters of an instance move when instances are added. bind them with $n or $n&&, &$n would dangle
+    > removing or resetting an instance ends its active task like teardown. exit gets the state provider of the last
+      step, it has to outlive the active tasks
+*/
+
+namespace TBT::Execute {
+
+  struct Blueprint {
+    struct Node {
+      Compiler::NodeHeader header_;
+      uint32_t parent_      = 0;  // index of the parent, the node count for the root
+      uint32_t child_begin_ = 0;  // the children are children_[child_begin_] ... in order
+      uint32_t next_        = 0;  // index of the node after the subtree, the node count after the last node
+      uint32_t offset_      = 0;  // the node in tree_, its parameters are bound from there like in execute_task
+      bool dynamic_         = false;  // binds $n parameters. the task differs from instance to instance
+    };  // Node
+
+    [[nodiscard]] uint32_t root() const noexcept { return static_cast<uint32_t>(nodes_.size()); }
+
+    [[nodiscard]] std::span<const uint8_t> bytes(const Node& _node) const noexcept {
+      return {tree_.data() + _node.offset_, _node.header_.node_size_};
+    }  // bytes
+
+    std::vector<uint8_t> tree_;
+    std::vector<Node> nodes_;  // pre-order
+    std::vector<uint32_t> children_;
+    std::vector<uint32_t> root_children_;
+    size_t slot_size_  = 1;  // largest task of the tree
+    size_t slot_align_ = 1;
+  };  // Blueprint
+
+  // decodes a tree made by compile_static or compile_dynamic. the blueprint keeps its own copy of the tree
+  template <class Variant>
+  [[nodiscard]] std::shared_ptr<const Blueprint> make_blueprint(std::span<const uint8_t> _tree) {
+    using namespace Compiler;
+    constexpr auto layouts = variant_type_layouts<Variant>();
+
+    const Header header    = read_global_node_header(_tree);
+    auto out               = std::make_shared<Blueprint>();
+    out->tree_.assign(_tree.begin(), _tree.end());
+
+    std::vector<uint32_t> offsets(header.node_count_);
+    uint32_t ptr = header.first_node_offset_;
+    for (uint32_t i = 0; i < header.node_count_; ++i) {
+      offsets[i] = ptr;
+      ptr += read_node_header(_tree.subspan(ptr)).node_size_;
+    }
+
+    const auto index_of = [&](const uint32_t _offset) {
+      const auto it = std::find(offsets.begin(), offsets.end(), _offset);
+      return static_cast<uint32_t>(it - offsets.begin());
+    };
+
+    out->nodes_.resize(header.node_count_);
+    for (uint32_t i = 0; i < header.node_count_; ++i) {
+      Blueprint::Node& node = out->nodes_[i];
+      const auto bytes      = _tree.subspan(offsets[i]);
+      node.header_          = read_node_header(bytes);
+      node.parent_          = index_of(node.header_.parent_);
+      node.child_begin_     = static_cast<uint32_t>(out->children_.size());
+      node.next_            = index_of(node.header_.next_);
+      node.offset_          = offsets[i];
+      for (uint32_t c = 0; c < node.header_.children_count_; ++c)
+        out->children_.push_back(index_of(read_child(c, bytes)));
+
+      for (uint32_t p = 0; p < node.header_.params_count_ && !node.dynamic_; ++p)
+        node.dynamic_ = read_payload(p, node.header_, bytes).index() == 3;
+
+      out->slot_size_  = std::max(out->slot_size_, layouts[node.header_.type_idx_].first);
+      out->slot_align_ = std::max(out->slot_align_, layouts[node.header_.type_idx_].second);
+    }
+
+    for (uint32_t c = 0; c < header.children_count_; ++c)
+      out->root_children_.push_back(index_of(read_root_child(c, _tree)));
+    return out;
+  }  // make_blueprint
+
+  // the mutable state of all instances of a blueprint. every instance has its own parameters
+  template <class Variant, class Params = std::tuple<>>
+  struct TreeInstances {
+    // task slots are allocated in chunks of instances. they never move, coroutines refer to them
+    static constexpr uint32_t chunk_size = 256;
+    // run_batch is called at the latest when this many instances wait for it. keeps the batch in the cache
+    static constexpr size_t batch_size   = 256;
+
+    struct alignas(std::max_align_t) SlotBlock {
+      std::byte bytes_[alignof(std::max_align_t)];
+    };  // SlotBlock
+
+    explicit TreeInstances(std::shared_ptr<const Blueprint> _blueprint)
+        : blueprint_(std::move(_blueprint)),
+          node_count_(blueprint_->root()),
+          slot_blocks_((blueprint_->slot_size_ + sizeof(SlotBlock) - 1) / sizeof(SlotBlock)) {
+      assert(blueprint_->slot_align_ <= alignof(SlotBlock));
+    }
+
+    TreeInstances(const TreeInstances&)            = delete;
+    TreeInstances& operator=(const TreeInstances&) = delete;
+
+    ~TreeInstances() {
+      for (uint32_t i = 0; i < used_.size(); ++i)
+        if (used_[i]) reset(i);
+    }
+
+    // a new instance starting at the root. indices of removed instances are reused
+    uint32_t add(Params _params = {}) {
+      uint32_t i;
+      if (!free_.empty()) {
+        i = free_.back();
+        free_.pop_back();
+        params_[i] = std::move(_params);
+      } else {
+        i = static_cast<uint32_t>(node_.size());
+        if (i % chunk_size == 0) slots_.push_back(std::make_unique<SlotBlock[]>(chunk_size * slot_blocks_));
+        node_.push_back(0);
+        last_result_.emplace_back();
+        live_.push_back(0);
+        used_.push_back(0);
+        co_.push_back(nullptr);
+        params_.push_back(std::move(_params));
+      }
+      node_[i]        = node_count_;
+      last_result_[i] = {};
+      used_[i]        = 1;
+      size_++;
+      return i;
+    }  // add
+
+    void remove(const uint32_t _i) {
+      assert(used_[_i]);
+      reset(_i);
+      used_[_i] = 0;
+      free_.push_back(_i);
+      size_--;
+    }  // remove
+
+    // ends the active task of the instance like teardown. the instance starts over at the root
+    void reset(const uint32_t _i) noexcept {
+      if (co_[_i]) std::coroutine_handle<>::from_address(co_[_i]).destroy();
+      if (live_[_i]) {
+        const int32_t type = blueprint_->nodes_[node_[_i]].header_.type_idx_;
+        exit_(slot(_i), type, states_);
+        destroy_task_at<Variant>(slot(_i), type);
+      }
+      co_[_i]          = nullptr;
+      live_[_i]        = 0;
+      node_[_i]        = node_count_;
+      last_result_[_i] = {};
+    }  // reset
+
+    // calls exit of the task in _slot with the state provider of the last step
+    template <class StateProvider>
+    static void exit_task(void* _slot, const int32_t _type, void* _states) {
+      StateProvider& states = *static_cast<StateProvider*>(_states);
+      visit_task<Variant>(
+          [&](auto& _t) {
+            if constexpr (Concepts::has_exit_sig_1<std::decay_t<decltype(_t)>, std::decay_t<StateProvider>>)
+              exit(_t, states);
+            else if constexpr (Concepts::has_exit_sig_2<std::decay_t<decltype(_t)>>)
+              exit(_t);
+          },
+          _type, _slot);
+    }  // exit_task
+
+    template <class StateProvider>
+    void use_states(StateProvider& _states) noexcept {
+      exit_   = &exit_task<StateProvider>;
+      states_ = const_cast<void*>(static_cast<const void*>(std::addressof(_states)));
+    }  // use_states
+
+    [[nodiscard]] void* slot(const uint32_t _i) noexcept {
+      return slots_[_i / chunk_size].get() + (_i % chunk_size) * slot_blocks_;
+    }  // slot
+
+    [[nodiscard]] bool contains(const uint32_t _i) const noexcept { return _i < used_.size() && used_[_i]; }
+    [[nodiscard]] size_t size() const noexcept { return size_; }
+
+    // memory owned by a single instance. the blueprint is shared and not included
+    [[nodiscard]] size_t bytes_per_instance() const noexcept {
+      return sizeof(uint32_t) + sizeof(Compiler::Result) + sizeof(uint8_t) * 2 + sizeof(void*) +
+             sizeof(SlotBlock) * slot_blocks_ + sizeof(Params);
+    }  // bytes_per_instance
+
+    std::shared_ptr<const Blueprint> blueprint_;
+    uint32_t node_count_;
+    size_t slot_blocks_;
+
+    std::vector<uint32_t> node_;
+    std::vector<Compiler::Result> last_result_;
+    std::vector<uint8_t> live_;
+    std::vector<uint8_t> used_;
+    std::vector<void*> co_;
+    std::vector<std::unique_ptr<SlotBlock[]>> slots_;
+    std::vector<Params> params_;
+
+    std::vector<uint32_t> free_;
+    size_t size_ = 0;
+
+    // set by every step, see reset. there is no active task before the first step
+    void (*exit_)(void*, int32_t, void*) = nullptr;
+    void* states_                         = nullptr;
+
+    // instances waiting for a run_batch call, one list per task type
+    std::vector<std::vector<uint32_t>> batches_ = std::vector<std::vector<uint32_t>>(std::variant_size_v<Variant>);
+  };  // TreeInstances
+
+  namespace detail {
+    // the task of _node is done. a failed task skips its children, the last node returns to the root
+    template <class Variant, class Params>
+    void leave_instance_node(TreeInstances<Variant, Params>& _set, const uint32_t _i, const uint32_t _node,
+                             const State _res) {
+      const Blueprint& bp         = *_set.blueprint_;
+      const Blueprint::Node& node = bp.nodes_[_node];
+
+      if (_res != FAILED && node.header_.children_count_ > 0)
+        _set.node_[_i] = bp.children_[node.child_begin_];
+      else
+        _set.node_[_i] = node.next_;
+      _set.last_result_[_i] = {_res, _set.node_[_i] == bp.root() ? UP : DOWN};
+    }  // leave_instance_node
+
+    // one step of instance _i on node _node. mirrors execute_node_static
+    template <class Task, class Variant, class Params, class StateProvider>
+    void execute_instance_node(TreeInstances<Variant, Params>& _set, const uint32_t _i, const uint32_t _node,
+                               StateProvider& _states) {
+      using SP                    = std::decay_t<StateProvider>;
+      using Handle                = std::coroutine_handle<CoState::promise_type>;
+
+      const Blueprint::Node& node = _set.blueprint_->nodes_[_node];
+      Compiler::Result& result    = _set.last_result_[_i];
+      Task* task                  = std::launder(reinterpret_cast<Task*>(_set.slot(_i)));
+
+      const auto finish           = [&](const State _res) {
+        if constexpr (Concepts::has_exit_sig_1<Task, SP>)
+          exit(*task, _states);
+        else if constexpr (Concepts::has_exit_sig_2<Task>)
+          exit(*task);
+
+        if constexpr (Concepts::is_corun<Task, SP>) {
+          Handle::from_address(_set.co_[_i]).destroy();
+          _set.co_[_i] = nullptr;
+        }
+        std::destroy_at(task);
+        _set.live_[_i] = 0;
+        leave_instance_node(_set, _i, _node, _res);
+      };
+
+      const auto check_coroutine = [&]() {
+        const CoStateValues& values = Handle::from_address(_set.co_[_i]).promise().values_;
+        if (values.state_ == RETURN)
+          finish(values.val_);
+        else
+          result = {BUSY, UP};
+      };
+
+      // first time entering the task
+      if (result.dir_ == DOWN) {
+        task = ::new (_set.slot(_i)) Task();
+        bind_node_task(*task, node.header_, _set.blueprint_->bytes(node), _set.params_[_i]);
+        _set.live_[_i] = 1;
+
+        if constexpr (Concepts::is_corun<Task, SP>) {
+          if constexpr (Concepts::has_corun_sig_1<Task, SP>)
+            _set.co_[_i] = co_run(*task, _states).handle_.address();
+          else
+            _set.co_[_i] = co_run(*task).handle_.address();
+          check_coroutine();
+        } else {
+          State res = SUCCESS;
+          if constexpr (Concepts::has_init_sig_1<Task, SP>)
+            res = init(*task, _states);
+          else if constexpr (Concepts::has_init_sig_2<Task>)
+            res = init(*task);
+
+          if (res != FAILED) {
+            if constexpr (Concepts::has_run_sig_1<Task, SP>)
+              res = run(*task, _states);
+            else if constexpr (Concepts::has_run_sig_2<Task>)
+              res = run(*task);
+          }
+
+          if (res == BUSY)
+            result = {BUSY, UP};
+          else
+            finish(res);
+        }
+        return;
+      }
+
+      // keep running the task
+      if constexpr (Concepts::is_corun<Task, SP>) {
+        Handle co                   = Handle::from_address(_set.co_[_i]);
+        const CoStateValues& values = co.promise().values_;
+        assert(values.state_ != RETURN);
+        if (values.state_ == YIELD || (values.state_ == AWAIT && values.a_done_)) co.resume();
+        check_coroutine();
+      } else {
+        State res = SUCCESS;
+        if constexpr (Concepts::has_run_sig_1<Task, SP>)
+          res = run(*task, _states);
+        else if constexpr (Concepts::has_run_sig_2<Task>)
+          res = run(*task);
+
+        if (res == BUSY)
+          result = {BUSY, UP};
+        else
+          finish(res);
+      }
+    }  // execute_instance_node
+
+    // the instances in _batch all enter a node of type Task. their tasks are built side by side and evaluated by a
+    // single run_batch call. a BUSY result enters the node again in the next step
+    template <class Task, class Variant, class Params, class StateProvider>
+    void execute_instance_batch(TreeInstances<Variant, Params>& _set, std::span<const uint32_t> _batch,
+                                StateProvider& _states) {
+      static_assert(!Concepts::is_corun<Task, std::decay_t<StateProvider>>, "batched tasks can not be co-routines");
+
+      thread_local std::vector<Task> tasks;
+      thread_local std::vector<State> results;
+      tasks.clear();
+      results.assign(_batch.size(), SUCCESS);
+
+      // consecutive instances on the same node without $n parameters get a copy of the previous task
+      const Blueprint& bp = *_set.blueprint_;
+      uint32_t last       = _set.node_count_;
+      for (const uint32_t i : _batch) {
+        const uint32_t n            = _set.node_[i];
+        const Blueprint::Node& node = bp.nodes_[n];
+        if constexpr (std::is_copy_constructible_v<Task>) {
+          if (n == last) {
+            tasks.push_back(tasks.back());
+            continue;
+          }
+          last = node.dynamic_ ? _set.node_count_ : n;
+        }
+        bind_node_task(tasks.emplace_back(), node.header_, bp.bytes(node), _set.params_[i]);
+      }
+
+      run_batch(std::span<Task>(tasks), _states, std::span<State>(results));
+      tasks.clear();
+
+      for (size_t k = 0; k < _batch.size(); ++k)
+        if (results[k] != BUSY) leave_instance_node(_set, _batch[k], _set.node_[_batch[k]], results[k]);
+    }  // execute_instance_batch
+
+    template <class Variant, class Params, class StateProvider>
+    struct InstanceOps {
+      using Set     = TreeInstances<Variant, Params>;
+      using NodeFn  = void (*)(Set&, uint32_t, uint32_t, StateProvider&);
+      using BatchFn = void (*)(Set&, std::span<const uint32_t>, StateProvider&);
+
+      static constexpr auto nodes = []<size_t... Is>(std::index_sequence<Is...>) {
+        return std::array<NodeFn, sizeof...(Is)>{
+            &execute_instance_node<std::variant_alternative_t<Is, Variant>, Variant, Params, StateProvider>...};
+      }(std::make_index_sequence<std::variant_size_v<Variant>>{});
+
+      // nullptr for tasks without run_batch
+      static constexpr auto batches = []<size_t... Is>(std::index_sequence<Is...>) {
+        return std::array<BatchFn, sizeof...(Is)>{[]() -> BatchFn {
+          using Task = std::variant_alternative_t<Is, Variant>;
+          if constexpr (Concepts::has_run_batch<Task, std::decay_t<StateProvider>>)
+            return &execute_instance_batch<Task, Variant, Params, StateProvider>;
+          else
+            return nullptr;
+        }()...};
+      }(std::make_index_sequence<std::variant_size_v<Variant>>{});
+    };  // InstanceOps
+
+    // enters the first root child if the instance starts over
+    template <class Variant, class Params>
+    void begin_instance_step(TreeInstances<Variant, Params>& _set, const uint32_t _i) {
+      const Blueprint& bp = *_set.blueprint_;
+      if (_set.node_[_i] == bp.root() && _set.last_result_[_i].dir_ == DOWN) _set.node_[_i] = bp.root_children_[0];
+    }  // begin_instance_step
+
+    // the instance left the last node. the tree is done
+    template <class Variant, class Params>
+    State end_instance_step(TreeInstances<Variant, Params>& _set, const uint32_t _i) {
+      Compiler::Result& result = _set.last_result_[_i];
+      if (result.dir_ == UP && _set.node_[_i] == _set.blueprint_->root()) {
+        result.dir_ = DOWN;
+        return SUCCESS;
+      }
+      return BUSY;
+    }  // end_instance_step
+  }  // namespace detail
+
+  // one step of instance _i. same contract as execute_step
+  template <class Variant, class Params, class StateProvider>
+  State execute_instance_step(TreeInstances<Variant, Params>& _set, const uint32_t _i, StateProvider& _states) {
+    using Ops = detail::InstanceOps<Variant, Params, StateProvider>;
+    if (_set.node_count_ == 0) return SUCCESS;
+
+    // instances are not queued. a coroutine awaiting in here must not park a queued tree calling this
+    Parking* const outer = std::exchange(detail::current_parking_, nullptr);
+    _set.use_states(_states);
+    detail::begin_instance_step(_set, _i);
+
+    const uint32_t node = _set.node_[_i];
+    const int32_t type  = _set.blueprint_->nodes_[node].header_.type_idx_;
+    if (Ops::batches[type] && _set.last_result_[_i].dir_ == DOWN)
+      Ops::batches[type](_set, std::span<const uint32_t>(&_i, 1), _states);
+    else
+      Ops::nodes[type](_set, _i, node, _states);
+
+    const State res          = detail::end_instance_step(_set, _i);
+    detail::current_parking_ = outer;
+    return res;
+  }  // execute_instance_step
+
+  // one step of every instance. returns how many of them finished the tree in this step
+  // instances entering a task with run_batch are collected per task type and evaluated in blocks of batch_size
+  template <class Variant, class Params, class StateProvider>
+  size_t execute_instances(TreeInstances<Variant, Params>& _set, StateProvider& _states) {
+    using Ops = detail::InstanceOps<Variant, Params, StateProvider>;
+    if (_set.node_count_ == 0) return _set.size();
+
+    const Blueprint& bp  = *_set.blueprint_;
+    size_t done          = 0;
+    Parking* const outer = std::exchange(detail::current_parking_, nullptr);  // see execute_instance_step
+    const auto flush     = [&](std::vector<uint32_t>& _batch, const size_t _type) {
+      Ops::batches[_type](_set, _batch, _states);
+      for (const uint32_t i : _batch)
+        if (detail::end_instance_step(_set, i) != BUSY) done++;
+      _batch.clear();
+    };
+
+    _set.use_states(_states);
+    for (uint32_t i = 0; i < _set.used_.size(); ++i) {
+      if (!_set.used_[i]) continue;
+      detail::begin_instance_step(_set, i);
+
+      const uint32_t node = _set.node_[i];
+      const int32_t type  = bp.nodes_[node].header_.type_idx_;
+      if (Ops::batches[type] && _set.last_result_[i].dir_ == DOWN) {
+        std::vector<uint32_t>& batch = _set.batches_[type];
+        batch.push_back(i);
+        if (batch.size() == _set.batch_size) flush(batch, type);
+        continue;
+      }
+
+      Ops::nodes[type](_set, i, node, _states);
+      if (detail::end_instance_step(_set, i) != BUSY) done++;
+    }
+
+    for (size_t type = 0; type < _set.batches_.size(); ++type)
+      if (!_set.batches_[type].empty()) flush(_set.batches_[type], type);
+    detail::current_parking_ = outer;
+    return done;
+  }  // execute_instances
+
+}  // namespace TBT::Execute
\ No newline at end of file
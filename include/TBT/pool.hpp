@@ -0,0 +1,211 @@
+#pragma once
+
+#include <TBT/defines.hpp>
+#include <memory>
+
+namespace TBT {
+
+  struct PoolStats {
+    size_t allocated_ = 0;  // blocks requested from the upstream allocator
+    size_t reused_    = 0;  // requests served from the free list
+    size_t released_  = 0;  // blocks handed back to the upstream allocator by trim()
+    size_t live_      = 0;  // blocks currently in use. not counted by the thread-local pools
+    size_t free_      = 0;  // blocks waiting in the free list
+  };  // PoolStats
+
+  /*
+    Free-list based pool for task states.
+      > every block can hold any alternative of the Variant
+      > blocks are recycled and only returned to the upstream allocator by trim() or the destructor
+      > not thread-safe. use one pool per StateProvider or the thread-local pool from local()
+      > in a parallel frame a block of a thread-local pool can be freed on another worker. it joins the free list of
+        that worker, so the thread-local pools don't count live_
+  */
+
+  template <class Variant, class Allocator = std::allocator<Variant>>
+  struct TaskPool {
+    union Block {
+      Block* next_;
+      alignas(Variant) std::byte storage_[sizeof(Variant)];
+    };  // Block
+
+    using BlockAllocator                = typename std::allocator_traits<Allocator>::template rebind_alloc<Block>;
+    using BlockTraits                   = std::allocator_traits<BlockAllocator>;
+
+    static constexpr size_t block_size  = sizeof(Block);
+    static constexpr size_t block_align = alignof(Block);
+
+    TaskPool()                          = default;
+    explicit TaskPool(const Allocator& _alloc) : alloc_(_alloc) {}
+
+    struct Local {};  // constructs the thread-local pool, see local()
+    explicit TaskPool(Local) : local_(true) {}
+
+    TaskPool(const TaskPool&)            = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    // blocks still in use are not owned by the pool anymore and will not be freed
+    ~TaskPool() { trim(); }
+
+    [[nodiscard]] void* allocate() {
+      if (!local_) stats_.live_++;
+      if (free_) {
+        Block* b = free_;
+        free_    = b->next_;
+        stats_.free_--;
+        stats_.reused_++;
+        return b->storage_;
+      }
+      stats_.allocated_++;
+      return BlockTraits::allocate(alloc_, 1)->storage_;
+    }  // allocate
+
+    void deallocate(void* _ptr) noexcept {
+      assert(_ptr != nullptr);
+      Block* b = reinterpret_cast<Block*>(_ptr);
+      b->next_ = free_;
+      free_    = b;
+      if (!local_) stats_.live_--;
+      stats_.free_++;
+    }  // deallocate
+
+    // makes sure at least _n blocks can be handed out without touching the upstream allocator
+    void reserve(size_t _n) {
+      while (stats_.free_ < _n) {
+        Block* b = BlockTraits::allocate(alloc_, 1);
+        b->next_ = free_;
+        free_    = b;
+        stats_.allocated_++;
+        stats_.free_++;
+      }
+    }  // reserve
+
+    // returns unused blocks to the upstream allocator until at most _keep remain
+    void trim(size_t _keep = 0) noexcept {
+      while (free_ && stats_.free_ > _keep) {
+        Block* b = free_;
+        free_    = b->next_;
+        BlockTraits::deallocate(alloc_, b, 1);
+        stats_.free_--;
+        stats_.released_++;
+      }
+    }  // trim
+
+    [[nodiscard]] const PoolStats& stats() const noexcept { return stats_; }
+
+    // fallback pool used when the StateProvider does not provide its own
+    [[nodiscard]] static TaskPool& local() {
+      static_assert(BlockTraits::is_always_equal::value, "blocks move between the thread-local pools");
+      thread_local TaskPool pool(Local{});
+      return pool;
+    }  // local
+
+    BlockAllocator alloc_;
+    Block* free_ = nullptr;
+    PoolStats stats_;
+    bool local_ = false;
+  };  // TaskPool
+
+  /*
+    Size-class pool for coroutine frames.
+      > requests are rounded up to the next power of two from min_size to max_size. larger frames bypass the pool
+      > freed frames are kept per size class and only returned to the upstream allocator by trim() or the destructor
+      > not thread-safe. use one pool per StateProvider (frame_pool_) or the thread-local pool from local()
+      > frames of the thread-local pools move between threads the same way as the blocks of the TaskPool
+  */
+
+  template <class Allocator = std::allocator<std::byte>>
+  struct FramePool {
+    struct Block {
+      Block* next_;
+    };  // Block
+
+    using ByteAllocator                 = typename std::allocator_traits<Allocator>::template rebind_alloc<std::byte>;
+    using ByteTraits                    = std::allocator_traits<ByteAllocator>;
+
+    static constexpr size_t min_size    = 64;
+    static constexpr size_t max_size    = 4096;
+    static constexpr size_t class_count = 7;  // 64, 128, ..., 4096
+
+    FramePool()                         = default;
+    explicit FramePool(const Allocator& _alloc) : alloc_(_alloc) {}
+
+    struct Local {};  // constructs the thread-local pool, see local()
+    explicit FramePool(Local) : local_(true) {}
+
+    FramePool(const FramePool&)            = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // frames still in use are not owned by the pool anymore and will not be freed
+    ~FramePool() { trim(); }
+
+    // index of the size class serving _n bytes. class_count if _n is larger than max_size
+    static constexpr size_t size_class(const size_t _n) noexcept {
+      size_t c = 0;
+      while (c < class_count && (min_size << c) < _n) ++c;
+      return c;
+    }  // size_class
+
+    [[nodiscard]] void* allocate(const size_t _n) {
+      const size_t c = size_class(_n);
+      if (!local_) stats_.live_++;
+      if (c < class_count && free_[c]) {
+        Block* b = free_[c];
+        free_[c] = b->next_;
+        stats_.free_--;
+        stats_.reused_++;
+        return b;
+      }
+      stats_.allocated_++;
+      return ByteTraits::allocate(alloc_, c < class_count ? min_size << c : _n);
+    }  // allocate
+
+    // _n must be the size passed to allocate
+    void deallocate(void* _ptr, const size_t _n) noexcept {
+      assert(_ptr != nullptr);
+      const size_t c = size_class(_n);
+      if (!local_) stats_.live_--;
+      if (c == class_count) {
+        ByteTraits::deallocate(alloc_, static_cast<std::byte*>(_ptr), _n);
+        stats_.released_++;
+        return;
+      }
+      Block* b = ::new (_ptr) Block{free_[c]};
+      free_[c] = b;
+      stats_.free_++;
+    }  // deallocate
+
+    // returns unused frames to the upstream allocator until at most _keep remain per size class
+    void trim(const size_t _keep = 0) noexcept {
+      for (size_t c = 0; c < class_count; ++c) {
+        size_t n = 0;
+        for (Block** b = &free_[c]; *b;) {
+          if (n++ < _keep) {
+            b = &(*b)->next_;
+            continue;
+          }
+          Block* r = *b;
+          *b       = r->next_;
+          ByteTraits::deallocate(alloc_, reinterpret_cast<std::byte*>(r), min_size << c);
+          stats_.free_--;
+          stats_.released_++;
+        }
+      }
+    }  // trim
+
+    [[nodiscard]] const PoolStats& stats() const noexcept { return stats_; }
+
+    // fallback pool used when the StateProvider does not provide its own
+    [[nodiscard]] static FramePool& local() {
+      static_assert(ByteTraits::is_always_equal::value, "frames move between the thread-local pools");
+      thread_local FramePool pool(Local{});
+      return pool;
+    }  // local
+
+    [[no_unique_address]] ByteAllocator alloc_;
+    std::array<Block*, class_count> free_{};
+    PoolStats stats_;
+    bool local_ = false;
+  };  // FramePool
+
+}  // namespace TBT
\ No newline at end of file
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <TBT/execute.hpp>
+
+/*
+  Sleeping trees.
+    > co_await sleep_for(d) / sleep_frames(n) in a coroutine, return park_for(d) / park_frames(n) from a legacy run()
+    > the tree is parked (see Execute::Parking) and put into a timer wheel of its queue. it costs nothing until it is
+      due
+    > every queue has two wheels. one counts frames, the other milliseconds of the steady clock
+    > the queue advances both wheels at the start of every frame. due trees run in that frame
+    > sleeping is a feature of the queue. outside of it the coroutine versions return at once and park_* returns BUSY
+*/
+
+namespace TBT {
+
+  /*
+    Hierarchical timer wheel. 4 levels of 64 slots cover 2^24 ticks, later timers are carried along in the last level.
+      > insert and remove are O(1), advancing by one tick is O(1) amortized
+      > a timer lands in the lowest level whose digit is the first one in which due and now differ. when the lower
+        digits of now wrap, the timers of the next level are moved down
+  */
+  struct TimerWheel {
+    static constexpr uint32_t bits   = 6;
+    static constexpr uint32_t slots  = 1u << bits;
+    static constexpr uint64_t mask   = slots - 1;
+    static constexpr uint32_t levels = 4;
+
+    // timers due now or earlier fire with the next tick
+    void insert(Execute::Timer& _t) noexcept {
+      assert(_t.prev_ == nullptr);
+      if (_t.due_ <= now_) _t.due_ = now_ + 1;
+      link(_t);
+    }  // insert
+
+    void remove(Execute::Timer& _t) noexcept {
+      assert(_t.prev_ != nullptr);
+      *_t.prev_ = _t.next_;
+      if (_t.next_) _t.next_->prev_ = _t.prev_;
+      _t.next_ = nullptr;
+      _t.prev_ = nullptr;
+      count_--;
+    }  // remove
+
+    // moves now up to _to and calls _fire(timer) for every timer that became due. the timer is removed before
+    template <class F>
+    void advance(const uint64_t _to, F&& _fire) {
+      while (now_ < _to) {
+        if (count_ == 0) {
+          now_ = _to;
+          return;
+        }
+        now_++;
+
+        for (uint32_t l = 1; l < levels && (now_ & ((1ull << (bits * l)) - 1)) == 0; ++l) {
+          Execute::Timer* t = std::exchange(slots_[l][(now_ >> (bits * l)) & mask], nullptr);
+          while (t) {
+            Execute::Timer* next = t->next_;
+            t->prev_             = nullptr;
+            count_--;
+            link(*t);
+            t = next;
+          }
+        }
+
+        Execute::Timer* t = std::exchange(slots_[0][now_ & mask], nullptr);
+        while (t) {
+          Execute::Timer* next = t->next_;
+          t->next_             = nullptr;
+          t->prev_             = nullptr;
+          count_--;
+          _fire(*t);
+          t = next;
+        }
+      }
+    }  // advance
+
+    [[nodiscard]] uint64_t now() const noexcept { return now_; }
+    [[nodiscard]] size_t size() const noexcept { return count_; }
+
+    // due_ >= now_. a timer due now is put into the slot that fires in this tick
+    void link(Execute::Timer& _t) noexcept {
+      const uint64_t diff = _t.due_ ^ now_;
+      uint32_t level      = 0;
+      while (level + 1 < levels && (diff >> (bits * (level + 1))) != 0) ++level;
+
+      Execute::Timer*& head = slots_[level][(_t.due_ >> (bits * level)) & mask];
+      _t.next_              = head;
+      _t.prev_              = &head;
+      _t.wheel_             = this;
+      head                  = &_t;
+      if (_t.next_) _t.next_->prev_ = &_t.next_;
+      count_++;
+    }  // link
+
+    std::array<std::array<Execute::Timer*, slots>, levels> slots_{};
+    uint64_t now_ = 0;
+    size_t count_ = 0;
+  };  // TimerWheel
+
+  // the timer wheels of a TaskQueue
+  struct Timers {
+    using Clock = std::chrono::steady_clock;
+
+    // milliseconds since the queue was created
+    [[nodiscard]] uint64_t ticks(const Clock::time_point _t) const noexcept {
+      return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(_t - start_).count());
+    }  // ticks
+
+    void sleep_frames(Execute::Parking& _p, const uint64_t _frames) {
+      std::scoped_lock lock(mutex_);
+      _p.timer_.parking_ = &_p;
+      _p.timer_.due_     = frames_.now() + _frames;
+      frames_.insert(_p.timer_);
+    }  // sleep_frames
+
+    void sleep_for(Execute::Parking& _p, const Clock::duration _d) {
+      const auto ms = std::chrono::ceil<std::chrono::milliseconds>(_d);
+      std::scoped_lock lock(mutex_);
+      const uint64_t now = ticks(Clock::now());
+      // an empty wheel jumps to now instead of walking the ticks it was idle for
+      if (time_.size() == 0) time_.now_ = std::max(time_.now_, now);
+      _p.timer_.parking_ = &_p;
+      _p.timer_.due_     = now + static_cast<uint64_t>(ms.count());
+      time_.insert(_p.timer_);
+    }  // sleep_for
+
+    // takes the timer out of its wheel if the tree still sleeps
+    void cancel(Execute::Timer& _t) {
+      std::scoped_lock lock(mutex_);
+      if (_t.prev_) _t.wheel_->remove(_t);
+    }  // cancel
+
+    // wakes every tree that is due in _frame or by now
+    void advance(const uint64_t _frame) {
+      const auto fire = [](Execute::Timer& _t) {
+        if (_t.values_)
+          _t.values_->set_done();
+        else
+          _t.parking_->unpark();
+      };
+
+      std::scoped_lock lock(mutex_);
+      frames_.advance(_frame, fire);
+      time_.advance(ticks(Clock::now()), fire);
+    }  // advance
+
+    [[nodiscard]] size_t size() const noexcept { return frames_.size() + time_.size(); }
+
+    TimerWheel frames_;
+    TimerWheel time_;
+    Clock::time_point start_ = Clock::now();
+    std::mutex mutex_;
+  };  // Timers
+
+  namespace detail {
+    // the timers of the queued item executed on this thread
+    [[nodiscard]] inline Execute::Parking* sleeping_parking() noexcept {
+      Execute::Parking* p = Execute::detail::current_parking_;
+      return p && p->timers_ ? p : nullptr;
+    }  // sleeping_parking
+  }  // namespace detail
+
+  // co_await sleep_for(d) / sleep_frames(n). the coroutine continues once the time is over
+  struct SleepAwaitable {
+    Execute::CoStateValues* values_ = nullptr;
+    uint64_t frames_                = 0;
+    Timers::Clock::duration time_{};
+    bool by_time_ = false;
+
+    bool await_ready() const noexcept { return by_time_ ? time_ <= Timers::Clock::duration::zero() : frames_ == 0; }
+
+    template <class Handle>
+    void await_suspend(const Handle&) {
+      Execute::Parking* p = detail::sleeping_parking();
+      if (!p) {
+        values_->set_done();
+        return;
+      }
+
+      p->timer_.values_ = values_;
+      if (by_time_)
+        p->timers_->sleep_for(*p, time_);
+      else
+        p->timers_->sleep_frames(*p, frames_);
+    }  // await_suspend
+
+    void await_resume() noexcept {}
+  };  // SleepAwaitable
+
+  template <class Rep, class Period>
+  [[nodiscard]] SleepAwaitable sleep_for(const std::chrono::duration<Rep, Period> _d) {
+    return SleepAwaitable{.time_ = std::chrono::ceil<Timers::Clock::duration>(_d), .by_time_ = true};
+  }  // sleep_for
+
+  [[nodiscard]] inline SleepAwaitable sleep_frames(const uint64_t _frames) {
+    return SleepAwaitable{.frames_ = _frames};
+  }  // sleep_frames
+
+  // return park_frames(n) from run(). run() is called again n frames later
+  [[nodiscard]] inline State park_frames(const uint64_t _frames) {
+    Execute::Parking* p = detail::sleeping_parking();
+    if (!p || _frames == 0) return BUSY;
+
+    p->timer_.values_ = nullptr;
+    p->state_.store(Execute::Parking::AWAITING, std::memory_order_release);
+    p->timers_->sleep_frames(*p, _frames);
+    return BUSY;
+  }  // park_frames
+
+  // return park_for(d) from run(). run() is called again in the first frame after d has passed
+  template <class Rep, class Period>
+  [[nodiscard]] State park_for(const std::chrono::duration<Rep, Period> _d) {
+    Execute::Parking* p = detail::sleeping_parking();
+    if (!p || _d <= _d.zero()) return BUSY;
+
+    p->timer_.values_ = nullptr;
+    p->state_.store(Execute::Parking::AWAITING, std::memory_order_release);
+    p->timers_->sleep_for(*p, std::chrono::ceil<Timers::Clock::duration>(_d));
+    return BUSY;
+  }  // park_for
+
+}  // namespace TBT
\ No newline at end of file
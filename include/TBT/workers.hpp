@@ -0,0 +1,91 @@
+#pragma once
+
+#include <TBT/defines.hpp>
+#include <memory>
+
+/*
+  Worker threads for executing independent trees in parallel.
+    > the thread calling run() takes part as worker 0. a pool of size 1 has no extra threads
+    > the threads sleep between frames and are woken up by run()
+    > worker_index() tells a task on which worker it is executed. use it to reach per-worker state (WorkerLocal)
+*/
+
+namespace TBT {
+
+  namespace detail {
+    inline thread_local uint32_t worker_index_ = 0;
+  }  // namespace detail
+
+  // index of the worker executing the current task. 0 outside of a pool and on the thread calling run()
+  [[nodiscard]] inline uint32_t worker_index() noexcept { return detail::worker_index_; }
+
+  struct WorkerPool {
+    explicit WorkerPool(const uint32_t _workers = std::max(1u, std::thread::hardware_concurrency())) {
+      threads_.reserve(_workers - 1);
+      for (uint32_t w = 1; w < _workers; ++w) threads_.emplace_back([this, w]() { work(w); });
+    }
+
+    WorkerPool(const WorkerPool&)            = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    ~WorkerPool() {
+      stop_ = true;
+      epoch_.fetch_add(1, std::memory_order_release);
+      epoch_.notify_all();
+      for (std::thread& t : threads_) t.join();
+    }
+
+    [[nodiscard]] uint32_t size() const noexcept { return static_cast<uint32_t>(threads_.size()) + 1; }
+
+    // calls _job(worker) once on every worker and returns when all of them are done
+    template <class F>
+    void run(F& _job) {
+      job_ = [](void* _ctx, const uint32_t _w) { (*static_cast<F*>(_ctx))(_w); };
+      ctx_ = &_job;
+      pending_.store(static_cast<uint32_t>(threads_.size()), std::memory_order_relaxed);
+      epoch_.fetch_add(1, std::memory_order_release);
+      epoch_.notify_all();
+
+      _job(0);
+
+      uint32_t p;
+      while ((p = pending_.load(std::memory_order_acquire)) != 0) pending_.wait(p, std::memory_order_acquire);
+    }  // run
+
+    void work(const uint32_t _w) {
+      detail::worker_index_ = _w;
+      uint32_t seen         = 0;
+      while (true) {
+        epoch_.wait(seen, std::memory_order_acquire);
+        seen = epoch_.load(std::memory_order_acquire);
+        if (stop_) return;
+        job_(ctx_, _w);
+        if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) pending_.notify_one();
+      }
+    }  // work
+
+    std::vector<std::thread> threads_;
+    void (*job_)(void*, uint32_t)  = nullptr;
+    void* ctx_                     = nullptr;
+    bool stop_                     = false;
+    std::atomic<uint32_t> epoch_   = 0;
+    std::atomic<uint32_t> pending_ = 0;
+  };  // WorkerPool
+
+  // one T per worker of a pool. padded so workers never share a cache line
+  template <class T>
+  struct WorkerLocal {
+    struct alignas(64) Slot {
+      T val_{};
+    };  // Slot
+
+    explicit WorkerLocal(const uint32_t _workers) : slots_(_workers) {}
+
+    [[nodiscard]] T& local() noexcept { return slots_[worker_index()].val_; }
+    [[nodiscard]] T& operator[](const uint32_t _w) noexcept { return slots_[_w].val_; }
+    [[nodiscard]] size_t size() const noexcept { return slots_.size(); }
+
+    std::vector<Slot> slots_;
+  };  // WorkerLocal
+
+}  // namespace TBT
\ No newline at end of file
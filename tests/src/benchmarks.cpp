@@ -0,0 +1,496 @@
+#include <TBT/TBT>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+// benchmarks are hidden by default. run them with: TBT_Tests "[benchmark]"
+
+using namespace TBT;
+using namespace Compiler;
+
+struct BenchLeaf {
+  int32_t val_ = 0;
+};
+#define TASK_TYPE BenchLeaf
+#include <TBT/magic.hpp>
+
+struct BenchCond {
+  float limit_ = 0.0f;
+};
+#define TASK_TYPE BenchCond
+#include <TBT/magic.hpp>
+
+struct BenchCondBatch {
+  float limit_ = 0.0f;
+};
+#define TASK_TYPE BenchCondBatch
+#include <TBT/magic.hpp>
+
+struct BenchWork {
+  int32_t n_ = 0;
+};
+#define TASK_TYPE BenchWork
+#include <TBT/magic.hpp>
+
+struct BenchCo {
+  int32_t val_ = 0;
+};
+#define TASK_TYPE BenchCo
+#include <TBT/magic.hpp>
+
+struct BenchAwait {};
+#define TASK_TYPE BenchAwait
+#include <TBT/magic.hpp>
+
+// waits for a very long time, by polling or by sleeping
+struct BenchPoll {
+  int32_t frames_ = 0;
+};
+#define TASK_TYPE BenchPoll
+#include <TBT/magic.hpp>
+
+struct BenchSleep {
+  int32_t frames_ = 0;
+};
+#define TASK_TYPE BenchSleep
+#include <TBT/magic.hpp>
+
+struct BenchListen {
+  int32_t id_ = 0;
+};
+#define TASK_TYPE BenchListen
+#include <TBT/magic.hpp>
+
+// awaits a chain of depth_ subtrees, queued or inline
+struct BenchNest {
+  int32_t depth_ = 0;
+  bool inline_   = false;
+};
+#define TASK_TYPE BenchNest
+#include <TBT/magic.hpp>
+
+template <class States>
+TBT::State run(const BenchLeaf& _t, States& _s) {
+  _s.runs_ += _t.val_;
+  return SUCCESS;
+}
+
+template <class States>
+Execute::CoState co_run(BenchCo& _t, States& _s) {
+  _s.runs_ += _t.val_;
+  co_yield 0;
+  co_return SUCCESS;
+}
+
+// waits on something that never finishes, e.g. a slow load
+struct PendingAwaitable {
+  Execute::CoStateValues* values_ = nullptr;
+
+  bool await_ready() noexcept { return false; }
+  template <class Handle>
+  void await_suspend(const Handle&) {}
+  State await_resume() noexcept { return SUCCESS; }
+};
+
+template <class States>
+Execute::CoState co_run(BenchAwait&, States&) {
+  co_await PendingAwaitable{};
+  co_return SUCCESS;
+}
+
+template <class States>
+Execute::CoState co_run(BenchPoll& _t, States&) {
+  for (int32_t i = 0; i < _t.frames_; ++i) co_yield 0;
+  co_return SUCCESS;
+}
+
+template <class States>
+Execute::CoState co_run(BenchSleep& _t, States&) {
+  co_await TBT::sleep_frames(_t.frames_);
+  co_return SUCCESS;
+}
+
+// reacts to every dispatch of its id
+template <class States>
+Execute::CoState co_run(BenchListen& _t, States& _s) {
+  for (;;) _s.runs_ += co_await _s.events_.next(_t.id_);
+}
+
+template <class States>
+Execute::CoState co_run(BenchNest& _t, States& _s) {
+  if (_t.depth_ == 0) {
+    _s.runs_++;
+  } else if (_t.inline_) {
+    co_await TBT_RUN_INLINE(0, "BenchNest($0, $1)", _s, FULL_1, _t.depth_ - 1, true)
+  } else {
+    co_await TBT_RUN(0, "BenchNest($0, $1)", _s, FULL_1, _t.depth_ - 1, false)
+  }
+  co_return SUCCESS;
+}
+
+// a threshold check, once per task and once for a whole batch
+template <class States>
+TBT::State run(const BenchCond& _t, States& _s) {
+  return _s.value_ < _t.limit_ ? SUCCESS : FAILED;
+}
+
+template <class States>
+void run_batch(std::span<BenchCondBatch> _tasks, States& _s, std::span<State> _results) {
+  for (size_t i = 0; i < _tasks.size(); ++i) _results[i] = _s.value_ < _tasks[i].limit_ ? SUCCESS : FAILED;
+}
+
+// some arithmetic standing in for game logic. writes only to per-worker state
+template <class States>
+TBT::State run(const BenchWork& _t, States& _s) {
+  uint64_t& acc = _s.acc_.local();
+  for (int32_t i = 0; i < _t.n_; ++i) acc = acc * 6364136223846793005ull + 1442695040888963407ull;
+  return SUCCESS;
+}
+
+//---------------------------------------
+
+using BenchVariant = std::variant<BenchLeaf>;
+
+struct BenchStates {
+  uint64_t runs_ = 0;
+};
+
+constexpr std::string_view flat_tree =
+    "BenchLeaf(1), BenchLeaf(1), BenchLeaf(1), BenchLeaf(1), BenchLeaf(1), "
+    "BenchLeaf(1), BenchLeaf(1), BenchLeaf(1), BenchLeaf(1), BenchLeaf(1), "
+    "BenchLeaf(1), BenchLeaf(1), BenchLeaf(1), BenchLeaf(1), BenchLeaf(1), "
+    "BenchLeaf(1), BenchLeaf(1), BenchLeaf(1), BenchLeaf(1), BenchLeaf(1)";
+
+constexpr std::string_view deep_tree =
+    "BenchLeaf(1)[BenchLeaf(1)[BenchLeaf(1)[BenchLeaf(1)[BenchLeaf(1)]]], BenchLeaf(1)[BenchLeaf(1)]], "
+    "BenchLeaf(1)[BenchLeaf(1), BenchLeaf(1)[BenchLeaf(1)[BenchLeaf(1)]]]";
+
+TEST_CASE("execute_step", "[.][benchmark]") {
+  BenchStates states;
+  const auto params = std::make_tuple();
+
+  {
+    constexpr auto res = compile_static<compute_size_static<BenchVariant>(flat_tree), BenchVariant>(flat_tree);
+    auto tree          = res;
+
+    BENCHMARK("flat tree (20 leaves): single step") {
+      return Execute::execute_step<BenchVariant>(tree, states, params);
+    };
+
+    BENCHMARK("flat tree (20 leaves): full pass") {
+      while (Execute::execute_step<BenchVariant>(tree, states, params) == BUSY) {}
+      return states.runs_;
+    };
+
+    BENCHMARK("flat tree (20 leaves): full pass in one call") {
+      size_t steps = SIZE_MAX;
+      return Execute::execute_steps<BenchVariant>(tree, states, params, steps);
+    };
+  }
+
+  {
+    constexpr auto res = compile_static<compute_size_static<BenchVariant>(deep_tree), BenchVariant>(deep_tree);
+    auto tree          = res;
+
+    BENCHMARK("nested tree (12 nodes): single step") {
+      return Execute::execute_step<BenchVariant>(tree, states, params);
+    };
+
+    BENCHMARK("nested tree (12 nodes): full pass") {
+      while (Execute::execute_step<BenchVariant>(tree, states, params) == BUSY) {}
+      return states.runs_;
+    };
+
+    BENCHMARK("nested tree (12 nodes): full pass in one call") {
+      size_t steps = SIZE_MAX;
+      return Execute::execute_steps<BenchVariant>(tree, states, params, steps);
+    };
+  }
+
+  {
+    constexpr std::string_view flat_dynamic =
+        "BenchLeaf($0), BenchLeaf($0), BenchLeaf($0), BenchLeaf($0), BenchLeaf($0), "
+        "BenchLeaf($0), BenchLeaf($0), BenchLeaf($0), BenchLeaf($0), BenchLeaf($0)";
+    constexpr auto res = compile_static<compute_size_static<BenchVariant>(flat_dynamic), BenchVariant>(flat_dynamic);
+    auto tree          = res;
+    auto dynamic       = std::make_tuple(int32_t{1});
+
+    BENCHMARK("flat tree (10 leaves, dynamic parameters): full pass") {
+      while (Execute::execute_step<BenchVariant>(tree, states, dynamic) == BUSY) {}
+      return states.runs_;
+    };
+  }
+}
+
+TEST_CASE("execute_step_static", "[.][benchmark]") {
+  BenchStates states;
+
+  {
+    static constexpr auto tree = compile_static<compute_size_static<BenchVariant>(flat_tree), BenchVariant>(flat_tree);
+    auto step                  = Execute::prepare_static<BenchVariant, tree>(states);
+
+    BENCHMARK("flat tree (20 leaves): single step") { return step(); };
+
+    BENCHMARK("flat tree (20 leaves): full pass") {
+      while (step() == BUSY) {}
+      return states.runs_;
+    };
+
+    BENCHMARK("flat tree (20 leaves): full pass in one call") {
+      size_t steps = SIZE_MAX;
+      return step(steps);
+    };
+  }
+
+  {
+    static constexpr auto tree = compile_static<compute_size_static<BenchVariant>(deep_tree), BenchVariant>(deep_tree);
+    auto step                  = Execute::prepare_static<BenchVariant, tree>(states);
+
+    BENCHMARK("nested tree (12 nodes): single step") { return step(); };
+
+    BENCHMARK("nested tree (12 nodes): full pass") {
+      while (step() == BUSY) {}
+      return states.runs_;
+    };
+  }
+
+  // the same work written by hand
+  BENCHMARK("hand-written (20 leaves)") {
+    for (int32_t i = 0; i < 20; ++i) run(BenchLeaf{1}, states);
+    return states.runs_;
+  };
+}
+
+TEST_CASE("coroutine activation", "[.][benchmark]") {
+  using CoVariant = std::variant<BenchCo>;
+  BenchStates states;
+
+  // every node starts, suspends and finishes a coroutine
+  static constexpr std::string_view co_tree =
+      "BenchCo(1), BenchCo(1), BenchCo(1), BenchCo(1), BenchCo(1), BenchCo(1), BenchCo(1), BenchCo(1)";
+  static constexpr auto tree = compile_static<compute_size_static<CoVariant>(co_tree), CoVariant>(co_tree);
+  auto step                  = Execute::prepare_static<CoVariant, tree>(states);
+
+  BENCHMARK("8 coroutines: full pass") {
+    while (step() == BUSY) {}
+    return states.runs_;
+  };
+}
+
+TEST_CASE("instancing", "[.][benchmark]") {
+  BenchStates states;
+  constexpr uint32_t count = 100000;
+  constexpr auto tree      = compile_static<compute_size_static<BenchVariant>(deep_tree), BenchVariant>(deep_tree);
+
+  // every entity owns a copy of the tree
+  std::vector<std::decay_t<decltype(tree)>> trees(count, tree);
+  BENCHMARK("100k copies of the tree (12 nodes): one step each") {
+    for (auto& t : trees) Execute::execute_step<BenchVariant>(t, states, std::make_tuple());
+    return states.runs_;
+  };
+
+  // every entity owns only its cursor
+  Execute::TreeInstances<BenchVariant> set(Execute::make_blueprint<BenchVariant>(tree));
+  for (uint32_t i = 0; i < count; ++i) set.add();
+  BENCHMARK("100k instances (12 nodes): one step each") { return Execute::execute_instances(set, states); };
+}
+
+TEST_CASE("batched conditions", "[.][benchmark]") {
+  struct CondStates {
+    float value_ = 1.0f;
+  } states;
+  constexpr uint32_t count = 100000;
+
+  {
+    using CondVariant = std::variant<BenchCond>;
+    Execute::TreeInstances<CondVariant> set(Execute::make_blueprint<CondVariant>(
+        compile_dynamic<CondVariant>("BenchCond(2.0), BenchCond(0.5), BenchCond(3.0), BenchCond(4.0)")));
+    for (uint32_t i = 0; i < count; ++i) set.add();
+    BENCHMARK("100k instances, 4 conditions: one step each") { return Execute::execute_instances(set, states); };
+  }
+
+  {
+    using CondVariant = std::variant<BenchCondBatch>;
+    Execute::TreeInstances<CondVariant> set(Execute::make_blueprint<CondVariant>(compile_dynamic<CondVariant>(
+        "BenchCondBatch(2.0), BenchCondBatch(0.5), BenchCondBatch(3.0), BenchCondBatch(4.0)")));
+    for (uint32_t i = 0; i < count; ++i) set.add();
+    BENCHMARK("100k instances, 4 batched conditions: one step each") {
+      return Execute::execute_instances(set, states);
+    };
+  }
+}
+
+template <class Variant_>
+struct BenchProvider {
+  using Variant = Variant_;
+  uint64_t runs_ = 0;
+  TBT::TaskQueue<> tasks_queue_;
+};
+
+template <class Variant_>
+struct EventBenchProvider {
+  using Variant = Variant_;
+  uint64_t runs_ = 0;
+  TBT::EventChannel<uint64_t> events_;
+  TBT::TaskQueue<> tasks_queue_;
+};
+
+TEST_CASE("queue", "[.][benchmark]") {
+  BenchProvider<BenchVariant> sp;
+
+  BENCHMARK("submit and finish a single node tree") {
+    TBT_RUN(0, "BenchLeaf(1)", sp, STEPWISE_1);
+    TBT_EXECUTE_QUEUE(sp)
+    return sp.runs_;
+  };
+
+  // trees that stay alive in mixed priorities while short ones come and go
+  BenchProvider<BenchVariant> live;
+  std::vector<TreeAwaitable<ExecutionItem>> handles;
+  for (int32_t i = 0; i < 1000; ++i) {
+    auto h = TBT_RUN(i % 8, "BenchLeaf(1), BenchLeaf(1), BenchLeaf(1), BenchLeaf(1)", live, STEPWISE_INF);
+    handles.push_back(std::move(h));
+  }
+
+  BENCHMARK("1000 live trees, 16 spawns per frame") {
+    for (int32_t i = 0; i < 16; ++i) TBT_RUN(i % 8, "BenchLeaf(1)", live, STEPWISE_1);
+    TBT_EXECUTE_QUEUE(live)
+    return live.runs_;
+  };
+
+  // all of them vs. a budget of 256 tree steps, the rest is carried over
+  BENCHMARK("1000 live trees") {
+    TBT_EXECUTE_QUEUE(live)
+    return live.runs_;
+  };
+
+  BENCHMARK("1000 live trees, 256 steps budget") {
+    TBT::Budget budget{.steps_ = 256};
+    TBT_EXECUTE_QUEUE_BUDGET(live, budget)
+    return live.runs_;
+  };
+
+  // trees waiting on async work do not cost anything per frame
+  BenchProvider<std::variant<BenchLeaf, BenchAwait>> waiting;
+  for (int32_t i = 0; i < 1000; ++i) TBT_RUN(i % 8, "BenchAwait", waiting, STEPWISE_1);
+  TBT_EXECUTE_QUEUE(waiting)
+
+  BENCHMARK("1000 awaiting trees, 16 spawns per frame") {
+    for (int32_t i = 0; i < 16; ++i) TBT_RUN(i % 8, "BenchLeaf(1)", waiting, STEPWISE_1);
+    TBT_EXECUTE_QUEUE(waiting)
+    return waiting.runs_;
+  };
+
+  // waiting for time by polling every frame and by sleeping in the timer wheel
+  BenchProvider<std::variant<BenchLeaf, BenchPoll>> polling;
+  for (int32_t i = 0; i < 1000; ++i) TBT_RUN(i % 8, "BenchPoll(1000000000)", polling, STEPWISE_1);
+  BENCHMARK("1000 polling trees, 16 spawns per frame") {
+    for (int32_t i = 0; i < 16; ++i) TBT_RUN(i % 8, "BenchLeaf(1)", polling, STEPWISE_1);
+    TBT_EXECUTE_QUEUE(polling)
+    return polling.runs_;
+  };
+
+  BenchProvider<std::variant<BenchLeaf, BenchSleep>> sleeping;
+  for (int32_t i = 0; i < 1000; ++i) TBT_RUN(i % 8, "BenchSleep(1000000000)", sleeping, STEPWISE_1);
+  BENCHMARK("1000 sleeping trees, 16 spawns per frame") {
+    for (int32_t i = 0; i < 16; ++i) TBT_RUN(i % 8, "BenchLeaf(1)", sleeping, STEPWISE_1);
+    TBT_EXECUTE_QUEUE(sleeping)
+    return sleeping.runs_;
+  };
+
+  // 64 ids, each frame one of them is dispatched and wakes 16 trees
+  EventBenchProvider<std::variant<BenchListen>> listening;
+  for (int32_t i = 0; i < 1024; ++i) TBT_RUN(i % 8, "BenchListen($0)", listening, STEPWISE_1, i % 64);
+  uint32_t next_id = 0;
+  BENCHMARK("1024 trees waiting for events, 16 woken per frame") {
+    listening.events_.dispatch(next_id++ % 64, 1);
+    TBT_EXECUTE_QUEUE(listening)
+    return listening.runs_;
+  };
+
+  // FULL_* trees of instant tasks pass all their nodes in one call of the prepared tree
+  BenchProvider<BenchVariant> full;
+  for (int32_t i = 0; i < 100; ++i) TBT_RUN(0, flat_tree, full, FULL_INF);
+  BENCHMARK("100 flat trees (20 leaves), FULL_INF") {
+    TBT_EXECUTE_QUEUE(full)
+    return full.runs_;
+  };
+}
+
+template <class Variant_>
+struct ParallelBenchProvider {
+  using Variant = Variant_;
+
+  explicit ParallelBenchProvider(const uint32_t _workers) : acc_(_workers) {}
+
+  TBT::WorkerLocal<uint64_t> acc_;
+  TBT::TaskQueue<> tasks_queue_;
+};
+
+TEST_CASE("parallel queue scaling", "[.][benchmark]") {
+  using WorkVariant       = std::variant<BenchWork>;
+  const uint32_t hardware = std::max(1u, std::thread::hardware_concurrency());
+
+  // 1000 independent trees of ~2us each per frame
+  for (uint32_t workers = 1; workers <= hardware; workers *= 2) {
+    TBT::WorkerPool pool(workers);
+    ParallelBenchProvider<WorkVariant> sp(workers);
+    for (int32_t i = 0; i < 1000; ++i) TBT_RUN(i % 4, "BenchWork(500), BenchWork(500)", sp, STEPWISE_INF);
+
+    BENCHMARK("1000 trees, " + std::to_string(workers) + " workers") {
+      TBT_EXECUTE_QUEUE_PARALLEL(sp, pool)
+      return sp.acc_[0];
+    };
+  }
+}
+// 16 threads hand 64 trees each to the queue, then one frame runs them
+TEST_CASE("submission contention", "[.][benchmark]") {
+  constexpr uint32_t producers   = 16;
+  constexpr int32_t per_producer = 64;
+
+  TBT::WorkerPool pool(producers);
+  BenchProvider<BenchVariant> sp;
+
+  auto submit = [&](uint32_t) {
+    for (int32_t i = 0; i < per_producer; ++i) TBT_SUBMIT(0, "BenchLeaf(1)", sp, STEPWISE_1);
+  };
+  BENCHMARK("16 producers, 64 trees each: submit") {
+    pool.run(submit);
+    TBT_EXECUTE_QUEUE(sp)
+    return sp.runs_;
+  };
+
+  // the usual workaround: a staging vector behind a mutex, moved into the queue before the frame
+  std::mutex mutex;
+  std::vector<TBT::TreeFunction> staged;
+  auto stage = [&](uint32_t) {
+    for (int32_t i = 0; i < per_producer; ++i) {
+      TBT::TreeFunction prepared = TBT_COMPILE_AND_PREPARE("BenchLeaf(1)", sp);
+      std::scoped_lock lock(mutex);
+      staged.push_back(std::move(prepared));
+    }
+  };
+  BENCHMARK("16 producers, 64 trees each: mutex-guarded staging") {
+    pool.run(stage);
+    for (TBT::TreeFunction& prepared : staged) TBT_ENQUEUE(0, std::move(prepared), sp, STEPWISE_1);
+    staged.clear();
+    TBT_EXECUTE_QUEUE(sp)
+    return sp.runs_;
+  };
+}
+
+// a tree awaiting 8 nested subtrees until it has finished
+TEST_CASE("nested subtrees", "[.][benchmark]") {
+  BenchProvider<std::variant<BenchNest>> sp;
+
+  BENCHMARK("8 awaited subtrees: queued") {
+    TBT_RUN(0, "BenchNest(8, false)", sp, STEPWISE_1);
+    while (!sp.tasks_queue_.empty()) { TBT_EXECUTE_QUEUE(sp) }
+    return sp.runs_;
+  };
+
+  BENCHMARK("8 awaited subtrees: inline") {
+    TBT_RUN(0, "BenchNest(8, true)", sp, STEPWISE_1);
+    while (!sp.tasks_queue_.empty()) { TBT_EXECUTE_QUEUE(sp) }
+    return sp.runs_;
+  };
+}
\ No newline at end of file
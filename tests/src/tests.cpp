@@ -2,6 +2,8 @@
 #include <catch2/catch_test_macros.hpp>
 #include <iomanip>
 #include <iostream>
+#include <numeric>
+#include <thread>
 
 using namespace TBT;
 using namespace Compiler;
@@ -337,7 +339,7 @@ TEST_CASE("serialize", "[Compiler]") {
       constexpr auto s        = serialize_composite(val);
       constexpr Composite res = deserialize_composite(s);
 
-      static_assert(val.cur_idx_ == res.cur_idx_);
+      static_assert(val.co_ == res.co_);
       static_assert(val.ptr_ == res.ptr_);
     }
 
@@ -363,7 +365,7 @@ TEST_CASE("serialize", "[Compiler]") {
       static_assert(val.children_count_ == res.children_count_);
       static_assert(val.last_result_.state_ == res.last_result_.state_);
       static_assert(val.last_result_.dir_ == res.last_result_.dir_);
-      static_assert(val.child_idx_ == res.child_idx_);
+      static_assert(val.slot_offset_ == res.slot_offset_);
     }
 
     {
@@ -458,7 +460,7 @@ TEST_CASE("serialize helper functions", "[Compiler]") {
     static_assert(val.last_result_.state_ == res.last_result_.state_);
     static_assert(val.last_result_.dir_ == res.last_result_.dir_);
 
-    static_assert(val.child_idx_ == res.child_idx_);
+    static_assert(val.slot_offset_ == res.slot_offset_);
   }
 
   SECTION("Composite") {
@@ -478,7 +480,7 @@ TEST_CASE("serialize helper functions", "[Compiler]") {
     }();
 
     static_assert(val.ptr_ == res.ptr_);
-    static_assert(val.cur_idx_ == res.cur_idx_);
+    static_assert(val.co_ == res.co_);
   }
 
   SECTION("NodeHeader") {
@@ -608,6 +610,26 @@ TEST_CASE("serialize helper functions", "[Compiler]") {
   }
 }
 
+TEST_CASE("native node layout", "[Compiler]") {
+  static_assert(RealSize::composite == sizeof(Composite));
+  static_assert(RealSize::header == sizeof(Header));
+  static_assert(RealSize::node_header == sizeof(NodeHeader));
+
+  // the runtime memcpy and the constexpr path produce the same bytes
+  constexpr NodeHeader val{1, 2, 3, 4, 5, 6, 7, 8, 9};
+  constexpr auto s_val = serialize_node_header(val);
+  const auto r_val     = std::bit_cast<std::array<uint8_t, sizeof(NodeHeader)>>(val);
+  REQUIRE(s_val == r_val);
+
+  std::array<uint8_t, RealSize::node_header> ar = {};
+  write_node_header(val, ar);
+  REQUIRE(ar == s_val);
+  const NodeHeader res = read_node_header(ar);
+  REQUIRE(res.params_count_ == val.params_count_);
+  REQUIRE(res.node_size_ == val.node_size_);
+  REQUIRE(res.next_ == val.next_);
+}
+
 struct TaskA {
   int32_t val_ = 1;
 };
@@ -639,6 +661,137 @@ struct TaskE {
 #define TASK_TYPE TaskE
 #include <TBT/magic.hpp>
 
+// too large to be stored inline in a tree
+struct TaskBig {
+  int32_t val_ = 7;
+  std::array<uint8_t, TBT_MAX_INLINE_TASK_SIZE> data_{};
+};
+#define TASK_TYPE TaskBig
+#include <TBT/magic.hpp>
+
+// owns a move-only member that can only be bound by moving the argument
+struct TaskOwner {
+  std::unique_ptr<int32_t> val_;
+};
+#define TASK_TYPE TaskOwner
+#include <TBT/magic.hpp>
+
+// counts its copies. a moved-from value is -1
+struct Tracked {
+  Tracked() = default;
+  explicit Tracked(const int32_t _val) : val_(_val) {}
+
+  Tracked(const Tracked& _other) : val_(_other.val_) { copies_++; }
+  Tracked(Tracked&& _other) noexcept : val_(std::exchange(_other.val_, -1)) {}
+
+  Tracked& operator=(const Tracked& _other) {
+    val_ = _other.val_;
+    copies_++;
+    return *this;
+  }
+
+  Tracked& operator=(Tracked&& _other) noexcept {
+    val_ = std::exchange(_other.val_, -1);
+    return *this;
+  }
+
+  int32_t val_                   = -1;
+  inline static int32_t copies_ = 0;
+};
+
+// binds a Tracked by value and by pointer
+struct TaskTracked {
+  Tracked val_;
+};
+#define TASK_TYPE TaskTracked
+#include <TBT/magic.hpp>
+
+struct TaskTrackedRef {
+  const Tracked* val_ = nullptr;
+};
+#define TASK_TYPE TaskTrackedRef
+#include <TBT/magic.hpp>
+
+// a coroutine that returns without ever suspending
+struct TaskQuick {
+  int32_t val_ = 60;
+};
+#define TASK_TYPE TaskQuick
+#include <TBT/magic.hpp>
+
+// waits until set_done() is called on the values it leaves in the StateProvider
+struct TaskWait {
+  int32_t val_ = 0;
+};
+#define TASK_TYPE TaskWait
+#include <TBT/magic.hpp>
+
+// sleeps for frames_ frames or ms_ milliseconds
+struct TaskSleep {
+  int32_t frames_ = 1;
+  int32_t ms_     = 0;
+};
+#define TASK_TYPE TaskSleep
+#include <TBT/magic.hpp>
+
+// the same for legacy tasks
+struct TaskNap {
+  int32_t frames_ = 1;
+  bool slept_     = false;
+};
+#define TASK_TYPE TaskNap
+#include <TBT/magic.hpp>
+
+// waits for an event. as coroutine and as legacy task
+struct TaskListen {
+  int32_t id_ = 0;
+};
+#define TASK_TYPE TaskListen
+#include <TBT/magic.hpp>
+
+struct TaskGuard {
+  int32_t id_ = 0;
+  TBT::EventChannel<int32_t>::Subscription sub_;
+};
+#define TASK_TYPE TaskGuard
+#include <TBT/magic.hpp>
+
+struct TaskCount {
+  int32_t n_  = 1;
+  bool main_  = false;
+  int32_t it_ = 0;
+};
+#define TASK_TYPE TaskCount
+#include <TBT/magic.hpp>
+
+struct TaskSpawn {};
+#define TASK_TYPE TaskSpawn
+#include <TBT/magic.hpp>
+
+struct TaskBatch {
+  int32_t val_ = 0;
+};
+#define TASK_TYPE TaskBatch
+#include <TBT/magic.hpp>
+
+// cancels the tree the StateProvider points at
+struct TaskAbort {};
+#define TASK_TYPE TaskAbort
+#include <TBT/magic.hpp>
+
+// awaits an inline subtree that cancels victim_
+struct TaskOuter {};
+#define TASK_TYPE TaskOuter
+#include <TBT/magic.hpp>
+
+// awaits a chain of depth_ inline subtrees. the last one sleeps for sleep_ frames, a negative sleep_ yields instead
+struct TaskNest {
+  int32_t depth_ = 0;
+  int32_t sleep_ = 0;
+};
+#define TASK_TYPE TaskNest
+#include <TBT/magic.hpp>
+
 struct MoveTask {
   bool enable{};
   int32_t steps{};
@@ -686,117 +839,131 @@ TEST_CASE("tuple_element_to_variant extracts the correct element", "[utility]")
   REQUIRE(*std::get<4>(v4) == -42);
 }
 
-TEST_CASE("construct_task - only static payload", "[construct_task]") {
-  std::vector<uint32_t> idxs{0, 1, 2, 3};  // map fields 0-3 to payload indices
-  std::vector<Parameter> pl{true, int32_t{-500}, 2.5f, int32_t{99}};
-  // only bool, float and signed ints are allowed as static payload
-  auto task = Execute::construct_task<MoveTask>(idxs, pl, std::tuple<>{});
-
-  REQUIRE(task.enable == true);
-  REQUIRE(task.steps == -500);
-  REQUIRE(task.speed == 2.5f);
-  REQUIRE(task.id == 99u);
-}
-
-TEST_CASE("construct_task - only dynamic parameters (tuple)", "[construct_task]") {
-  std::vector<uint32_t> idxs{0, 1, 2, 3};                        // indices >= pl.size() → taken from tuple
-  std::vector<std::variant<bool, int32_t, float, uint32_t>> pl;  // empty
-
-  auto params = std::make_tuple(false, int32_t{1000}, 10.0f, int32_t{7});
-
-  auto task   = Execute::construct_task<MoveTask>(idxs, pl, params);
-
-  REQUIRE(task.enable == false);
-  REQUIRE(task.steps == 1000);
-  REQUIRE(task.speed == 10.0f);
-  REQUIRE(task.id == 7u);
-}
-
-TEST_CASE("construct_task - mixed static + dynamic payload", "[construct_task]") {
-  // field order: enable, steps, speed, id
-  // idxs:  0 → static payload[0] = true
-  //        3 → dynamic tuple[0]   = -200   (3 - 1 = 2, but we will use tuple index 0)
-  //        1 → static payload[1] = 5.5f
-  //        2 → static payload[2] = 42u
-  std::vector<uint32_t> idxs{0, 3, 1, 2};
-  std::vector<Parameter> pl{true, 5.5f, int32_t{42}};
-
-  auto params = std::make_tuple(int32_t{-200});  // only one dynamic value
-
-  auto task   = Execute::construct_task<MoveTask>(idxs, pl, params);
-
-  REQUIRE(task.enable == true);  // static[0]
-  REQUIRE(task.steps == -200);   // dynamic tuple[0]
-  REQUIRE(task.speed == 5.5f);   // static[1]
-  REQUIRE(task.id == 42u);       // static[2]
-}
-
-TEST_CASE("construct_task - fewer indices than members → remaining default constructed", "[construct_task]") {
-  std::vector<uint32_t> idxs{0};  // only first field supplied
-  std::vector<Parameter> pl{true};
-
-  auto task = Execute::construct_task<MoveTask>(idxs, pl, std::tuple<>{});
+TEST_CASE("TaskPool - blocks are recycled", "[TaskPool]") {
+  using TaskVariant = std::variant<MoveTask, JumpTask>;
 
-  REQUIRE(task.enable == true);
-  REQUIRE(task.steps == 0);
-  REQUIRE(task.speed == 0.0f);
-  REQUIRE(task.id == 0u);
-}
+  TaskPool<TaskVariant> pool;
 
-TEST_CASE("alloc_task - empty index list (default construction)", "[alloc_task]") {
-  using TaskVariant = std::variant<MoveTask, JumpTask>;
+  void* p1 = pool.allocate();
+  void* p2 = pool.allocate();
+  REQUIRE(p1 != p2);
+  REQUIRE(pool.stats().allocated_ == 2);
+  REQUIRE(pool.stats().live_ == 2);
 
-  auto* ptr         = Execute::alloc_task<TaskVariant>(0, {}, {}, std::tuple<>{});
-  REQUIRE(ptr != nullptr);
-  REQUIRE(std::holds_alternative<MoveTask>(*ptr));
+  pool.deallocate(p1);
+  REQUIRE(pool.stats().free_ == 1);
 
-  auto* ptr2 = Execute::alloc_task<TaskVariant>(1, {}, {}, std::tuple<>{});
-  REQUIRE(std::holds_alternative<JumpTask>(*ptr2));
+  // the last released block is handed out first
+  void* p3 = pool.allocate();
+  REQUIRE(p3 == p1);
+  REQUIRE(pool.stats().reused_ == 1);
+  REQUIRE(pool.stats().allocated_ == 2);
 
-  delete ptr;
-  delete ptr2;
+  pool.deallocate(p2);
+  pool.deallocate(p3);
+  REQUIRE(pool.stats().live_ == 0);
+  REQUIRE(pool.stats().free_ == 2);
 }
 
-TEST_CASE("alloc_task - full construction via construct_task", "[alloc_task]") {
+TEST_CASE("TaskPool - reserve and trim", "[TaskPool]") {
   using TaskVariant = std::variant<MoveTask, JumpTask>;
 
-  std::vector<uint32_t> idxs{0, 1, 2, 3};
-  std::vector<Parameter> pl{false, int32_t{777}, 3.0f, int32_t{123}};
+  TaskPool<TaskVariant> pool;
+  pool.reserve(8);
+  REQUIRE(pool.stats().free_ == 8);
+  REQUIRE(pool.stats().allocated_ == 8);
 
-  // allocate variant index 0 → MoveTask
-  auto* ptr = Execute::alloc_task<TaskVariant>(0, idxs, pl, std::tuple<>{});
-  REQUIRE(std::holds_alternative<MoveTask>(*ptr));
+  void* p = pool.allocate();
+  REQUIRE(pool.stats().reused_ == 1);
+  REQUIRE(pool.stats().allocated_ == 8);
 
-  const auto& move = std::get<MoveTask>(*ptr);
-  REQUIRE(move.enable == false);
-  REQUIRE(move.steps == 777);
-  REQUIRE(move.speed == 3.0f);
-  REQUIRE(move.id == 123);
+  pool.trim(2);
+  REQUIRE(pool.stats().free_ == 2);
+  REQUIRE(pool.stats().released_ == 5);
 
-  delete ptr;
+  pool.deallocate(p);
+  pool.trim();
+  REQUIRE(pool.stats().free_ == 0);
+  REQUIRE(pool.stats().released_ == 8);
 }
 
-TEST_CASE("alloc_task - JumpTask with mixed payload", "[alloc_task]") {
-  using TaskVariant = std::variant<MoveTask, JumpTask>;
-
-  // JumpTask has two members: height (float), repeat (bool)
-  std::vector<uint32_t> idxs{1, 0};  // height ← payload[1] (float), repeat ← payload[0] (bool)
-  std::vector<Parameter> pl{true, 12.5f};
-
-  auto* ptr = Execute::alloc_task<TaskVariant>(1, idxs, pl, std::tuple<>{});  // index 1 = JumpTask
-  REQUIRE(std::holds_alternative<JumpTask>(*ptr));
-
-  const auto& jump = std::get<JumpTask>(*ptr);
-  REQUIRE(jump.height == 12.5f);
-  REQUIRE(jump.repeat == true);
+TEST_CASE("FramePool - size classes", "[TaskPool]") {
+  using Pool = FramePool<>;
+  REQUIRE(Pool::size_class(1) == 0);
+  REQUIRE(Pool::size_class(64) == 0);
+  REQUIRE(Pool::size_class(65) == 1);
+  REQUIRE(Pool::size_class(4096) == Pool::class_count - 1);
+  REQUIRE(Pool::size_class(4097) == Pool::class_count);
+
+  Pool pool;
+  void* p1 = pool.allocate(100);
+  pool.deallocate(p1, 100);
+
+  // any size of the same class gets the block back
+  void* p2 = pool.allocate(128);
+  REQUIRE(p2 == p1);
+  REQUIRE(pool.stats().reused_ == 1);
+
+  // other classes and large frames do not
+  void* p3 = pool.allocate(64);
+  void* p4 = pool.allocate(10000);
+  REQUIRE(pool.stats().allocated_ == 3);
+  pool.deallocate(p4, 10000);
+  REQUIRE(pool.stats().released_ == 1);
+
+  pool.deallocate(p2, 128);
+  pool.deallocate(p3, 64);
+  REQUIRE(pool.stats().live_ == 0);
+  REQUIRE(pool.stats().free_ == 2);
+  pool.trim();
+  REQUIRE(pool.stats().free_ == 0);
+  REQUIRE(pool.stats().released_ == 3);
+}
 
-  delete ptr;
+TEST_CASE("TaskPool - blocks freed on another thread", "[TaskPool]") {
+  using Pool = TaskPool<std::variant<int64_t, double>>;
+
+  void* p = Pool::local().allocate();
+  PoolStats other;
+  bool reused = false;
+
+  // the block joins the free list of the thread that frees it
+  std::thread([&]() {
+    Pool::local().deallocate(p);
+    other       = Pool::local().stats();
+    void* again = Pool::local().allocate();
+    reused      = again == p;
+    Pool::local().deallocate(again);
+  }).join();
+
+  REQUIRE(other.free_ == 1);
+  REQUIRE(reused);
+  // the thread-local pools don't count blocks in use
+  REQUIRE(other.live_ == 0);
+  REQUIRE(Pool::local().stats().live_ == 0);
+  REQUIRE(Pool::local().stats().free_ == 0);
 }
 
 // in an actual project we would use this.
 // using Variant = std::variant<TASK_TYPES>;
 using Variant = std::variant<TaskA, TaskB, TaskC>;
 
+TEST_CASE("dynamic parameter bindings", "[Composite]") {
+  const auto res      = compile_dynamic<Variant>("TaskA(&$1, $2&&, $3, &$4&&)");
+
+  const uint32_t rc0  = read_root_child(0, res);
+  const NodeHeader n1 = read_node_header({res.cbegin() + rc0, res.cend()});
+  // a parameter that is both a reference and moved is dropped
+  REQUIRE(n1.params_count_ == 3);
+
+  const auto pl0 = read_payload(0, n1, {res.cbegin() + rc0, res.cend()});
+  const auto pl1 = read_payload(1, n1, {res.cbegin() + rc0, res.cend()});
+  const auto pl2 = read_payload(2, n1, {res.cbegin() + rc0, res.cend()});
+  REQUIRE(std::get<3>(pl0) == (1 | bind_ref));
+  REQUIRE(std::get<3>(pl1) == (2 | bind_move));
+  REQUIRE(std::get<3>(pl2) == (3 | bind_copy));
+}
+
 TEST_CASE("dynamic extract node list", "[Composite]") {
   // constexpr auto vr            = variant_type_index_name_pairs<Variant>();
 
@@ -855,6 +1022,12 @@ TEST_CASE("dynamic extract node list", "[Composite]") {
     REQUIRE(pl.index() == 3);
     REQUIRE(std::get<3>(pl) == 4);
   }
+
+  // the node after each subtree
+  REQUIRE(n1.next_ == rc1);
+  REQUIRE(n2.next_ == c12);
+  REQUIRE(n3.next_ == rc1);
+  REQUIRE(n4.next_ == 0);
 }
 
 TEST_CASE("static extract node list", "[Composite]") {
@@ -873,6 +1046,15 @@ TEST_CASE("static extract node list", "[Composite]") {
   const Header gh = read_global_node_header(res);
   REQUIRE(gh.node_count_ == 4);
   REQUIRE(gh.children_count_ == 2);
+  // every node and its composite are aligned relative to the start of the tree
+  REQUIRE(gh.first_node_offset_ % RealSize::node_align == 0);
+  for (uint32_t ptr = gh.first_node_offset_, i = 0; i < gh.node_count_; ++i) {
+    const NodeHeader nh = read_node_header({res.cbegin() + ptr, res.cend()});
+    REQUIRE(ptr % RealSize::node_align == 0);
+    REQUIRE((ptr + nh.comp_offset_) % alignof(Composite) == 0);
+    ptr += nh.node_size_;
+  }
+
 
   const uint32_t rc0  = read_root_child(0, res);
   const uint32_t rc1  = read_root_child(1, res);
@@ -1012,6 +1194,174 @@ void exit(const TaskE& _t, States& _s) {
 
 //---------------------------------------
 
+template <class States>
+Execute::CoState co_run(TaskQuick& _t, States& _s) {
+  _s.t_.push_back(std::format("co_return [{}]", _t.val_));
+  co_return SUCCESS;
+}
+
+//---------------------------------------
+
+// completed from the outside
+struct ManualAwaitable {
+  Execute::CoStateValues** out_;
+  Execute::CoStateValues* values_ = nullptr;
+
+  bool await_ready() noexcept { return false; }
+  template <class Handle>
+  void await_suspend(const Handle&) {
+    *out_ = values_;
+  }
+  State await_resume() noexcept { return SUCCESS; }
+};
+
+template <class States>
+Execute::CoState co_run(TaskWait& _t, States& _s) {
+  _s.t_.push_back(std::format("wait [{}]", _t.val_));
+  co_await ManualAwaitable{&_s.waiting_[_t.val_]};
+  _s.t_.push_back(std::format("woken [{}]", _t.val_));
+  co_return SUCCESS;
+}
+
+//---------------------------------------
+
+template <class States>
+Execute::CoState co_run(TaskSleep& _t, States& _s) {
+  _s.t_.push_back(std::format("sleep [{}]", _t.frames_));
+  if (_t.ms_ > 0)
+    co_await TBT::sleep_for(std::chrono::milliseconds(_t.ms_));
+  else
+    co_await TBT::sleep_frames(_t.frames_);
+  _s.t_.push_back(std::format("slept [{}]", _t.frames_));
+  co_return SUCCESS;
+}
+
+template <class States>
+Execute::CoState co_run(TaskNest& _t, States& _s) {
+  _s.t_.push_back(std::format("nest [{}]", _t.depth_));
+  if (_t.depth_ > 0) {
+    co_await TBT_RUN_INLINE(0, "TaskNest($0, $1)", _s, FULL_1, _t.depth_ - 1, _t.sleep_)
+  } else if (_t.sleep_ > 0) {
+    co_await TBT::sleep_frames(_t.sleep_);
+  } else {
+    for (int32_t i = 0; i < -_t.sleep_; ++i) co_yield 0;
+  }
+  _s.t_.push_back(std::format("nested [{}]", _t.depth_));
+  co_return SUCCESS;
+}
+
+template <class States>
+TBT::State run(TaskNap& _t, States& _s) {
+  if (!_t.slept_) {
+    _t.slept_ = true;
+    _s.t_.push_back(std::format("nap [{}]", _t.frames_));
+    return TBT::park_frames(_t.frames_);
+  }
+  _s.t_.push_back(std::format("woke up [{}]", _t.frames_));
+  return SUCCESS;
+}
+
+//---------------------------------------
+
+template <class States>
+Execute::CoState co_run(TaskListen& _t, States& _s) {
+  const int32_t v = co_await _s.events_.next(_t.id_);
+  _s.t_.push_back(std::format("heard [{}] {}", _t.id_, v));
+  co_return SUCCESS;
+}
+
+template <class States>
+TBT::State run(TaskGuard& _t, States& _s) {
+  if (!_t.sub_.fired()) return _s.events_.wait(_t.id_, _t.sub_);
+  _s.t_.push_back(std::format("alarm [{}] {}", _t.id_, _t.sub_.value_));
+  return SUCCESS;
+}
+
+//---------------------------------------
+
+template <class States>
+TBT::State init(const TaskBig& _t, States& _s) {
+  _s.t_.push_back(std::format("init [{}]", _t.val_));
+  return SUCCESS;
+}
+template <class States>
+TBT::State run(const TaskBig& _t, States& _s) {
+  _s.t_.push_back(std::format("run [{}]", _t.val_));
+  return SUCCESS;
+}
+template <class States>
+void exit(const TaskBig& _t, States& _s) {
+  _s.t_.push_back(std::format("exit [{}]", _t.val_));
+}
+
+//---------------------------------------
+
+template <class States>
+TBT::State run(const TaskOwner& _t, States& _s) {
+  _s.t_.push_back(std::format("run [{}]", _t.val_ ? *_t.val_ : -1));
+  return SUCCESS;
+}
+
+template <class States>
+TBT::State run(const TaskTracked& _t, States& _s) {
+  _s.t_.push_back(std::format("tracked [{}]", _t.val_.val_));
+  return SUCCESS;
+}
+
+template <class States>
+TBT::State run(const TaskTrackedRef& _t, States& _s) {
+  _s.t_.push_back(std::format("ref [{}]", _t.val_ ? _t.val_->val_ : 0));
+  return SUCCESS;
+}
+
+//---------------------------------------
+
+template <class States>
+TBT::State run(TaskCount& _t, States& _s) {
+  _s.counts_.local()++;
+  if (_t.main_ && TBT::worker_index() != 0) _s.misplaced_++;
+  return ++_t.it_ < _t.n_ ? BUSY : SUCCESS;
+}
+
+//---------------------------------------
+
+template <class States>
+TBT::State run(const TaskSpawn&, States& _s) {
+  TBT_RUN(0, "TaskCount(2)", _s, STEPWISE_1);
+  return SUCCESS;
+}
+
+//---------------------------------------
+
+template <class States>
+void run_batch(std::span<TaskBatch> _tasks, States& _s, std::span<State> _results) {
+  _s.t_.push_back(std::format("batch [{}]", _tasks.size()));
+  for (size_t i = 0; i < _tasks.size(); ++i) _results[i] = _tasks[i].val_ > 0 ? SUCCESS : FAILED;
+}
+
+//---------------------------------------
+
+template <class States>
+TBT::State run(const TaskAbort&, States& _s) {
+  _s.t_.push_back("abort");
+  TBT::cancel(*_s.victim_);
+  return SUCCESS;
+}
+
+template <class States>
+Execute::CoState co_run(TaskOuter&, States& _s) {
+  _s.t_.push_back("outer");
+  co_await TBT_RUN_INLINE(0, "TaskAbort, TaskA", _s, FULL_1)
+  _s.t_.push_back("inner done");
+  co_return SUCCESS;
+}
+template <class States>
+void exit(const TaskOuter&, States& _s) {
+  _s.t_.push_back("exit outer");
+}
+
+//---------------------------------------
+
 TEST_CASE("hierarchy", "[Execute]") {
   using Variant                = std::variant<TaskA, TaskB, TaskC>;
 
@@ -1027,10 +1377,12 @@ TEST_CASE("hierarchy", "[Execute]") {
     std::vector<std::string> t_;
   } states;
 
-  auto tree = res;
-  while (Execute::execute_step<Variant>(tree, states, std::make_tuple(-5)) == BUSY) {
-    //
-  }
+  auto tree    = res;
+  size_t steps = 1;
+  while (Execute::execute_step<Variant>(tree, states, std::make_tuple(-5)) == BUSY) steps++;
+
+  // every step visits a node. finished children do not return through their parent, both TaskC are BUSY three times
+  REQUIRE(steps == 7 + 6);
 
   size_t i = 0;
   REQUIRE("init [3]" == states.t_[i++]);
@@ -1058,112 +1410,330 @@ TEST_CASE("hierarchy", "[Execute]") {
   REQUIRE("run [3]" == states.t_[i++]);
   REQUIRE("run [3]" == states.t_[i++]);
   REQUIRE("exit [3]" == states.t_[i++]);
-}
-
-template <class Variant_>
-struct StateProvider {
-  using Variant = Variant_;
-  std::vector<std::string> t_;
 
-  TBT::TaskQueue<> tasks_queue_;
-};
+  // the tree starts over with the same order
+  const auto first = states.t_;
+  states.t_.clear();
+  while (Execute::execute_step<Variant>(tree, states, std::make_tuple(-5)) == BUSY) {}
+  REQUIRE(states.t_ == first);
+}
 
-TEST_CASE("legacy", "[Execute]") {
-  using Variant1 = std::variant<TaskA, TaskB, TaskC, TaskD, TaskE>;
+TEST_CASE("run to suspension", "[Execute]") {
+  using Variant                = std::variant<TaskA, TaskB, TaskC>;
+  constexpr std::string_view s = "TaskC, TaskA($0)[TaskB(5)[TaskA, TaskB]] TaskA[TaskC]";
+  constexpr auto res           = compile_static<compute_size_static<Variant>(s), Variant>(s);
 
-  StateProvider<Variant1> state_provider;
+  struct States {
+    std::vector<std::string> t_;
+  };
 
-  // auto p = TBT_RUN(0, "TaskA($0)[TaskB($1), TaskC($2)] TaskA($3)", sp, STEPWISE_1, 10, 20, 30, 40);
+  // node by node
+  States reference;
+  auto reference_tree = res;
+  size_t nodes        = 1;
+  while (Execute::execute_step<Variant>(reference_tree, reference, std::make_tuple(-5)) == BUSY) nodes++;
+
+  // both TaskC return BUSY three times, every other node is passed in the same call
+  SECTION("dynamic") {
+    States states;
+    auto tree = res;
+    std::vector<size_t> calls;
+    State r = BUSY;
+    while (r == BUSY) {
+      size_t steps = 100;
+      r            = Execute::execute_steps<Variant>(tree, states, std::make_tuple(-5), steps);
+      calls.push_back(steps);
+    }
+    REQUIRE(states.t_ == reference.t_);
+    REQUIRE(calls.size() == 7);
+    REQUIRE(std::accumulate(calls.begin(), calls.end(), size_t{0}) == nodes);
+  }
 
-  auto p = [&]() -> auto {
-    TBT::ExecutionItem item;
-    item.last_update_ = state_provider.tasks_queue_.cur_frame_;
-    item.priority_    = 0;
-    item.mode_        = STEPWISE_1;
-    item.tree_ = TBT_COMPILE_AND_PREPARE("TaskA($0)[TaskB($1), TaskC($2)] TaskA($3)", state_provider, 10, 20, 30, 40);
-    state_provider.tasks_queue_.dirty_ = true;
-    std::future<TBT::State> f          = item.promise_.get_future();
-    state_provider.tasks_queue_.q_.push_back(std::move(item));
-    TBT::TreeAwaitable<TBT::ExecutionItem> out;
-    out.future_ = std::move(f);
-    out.ref_    = std::prev(state_provider.tasks_queue_.q_.end());
-    return out;
-  }();
+  SECTION("limited") {
+    States states;
+    auto tree    = res;
+    size_t calls = 0;
+    size_t total = 0;
+    State r      = BUSY;
+    while (r == BUSY) {
+      size_t steps = 2;
+      r            = Execute::execute_steps<Variant>(tree, states, std::make_tuple(-5), steps);
+      REQUIRE(steps <= 2);
+      total += steps;
+      calls++;
+    }
+    REQUIRE(states.t_ == reference.t_);
+    REQUIRE(total == nodes);
+    REQUIRE(calls > 7);
+  }
 
-  for (int32_t i = 0; i < 1000; ++i) {
-    state_provider.tasks_queue_.cur_frame_++;
-    if (!state_provider.tasks_queue_.q_.empty()) {
-      if (state_provider.tasks_queue_.dirty_) {
-        state_provider.tasks_queue_.dirty_ = false;
-        state_provider.tasks_queue_.q_.sort(
-            [](const auto& _v1, const auto& _v2) { return _v1.priority_ > _v2.priority_; });
-      }
-      auto& queue = state_provider.tasks_queue_.q_;
-      for (auto curr = queue.begin(); curr != queue.end(); ++curr) {
-        TBT::ExecutionItem& item = *curr;
-        if (item.last_update_ == state_provider.tasks_queue_.cur_frame_) continue;
-        item.last_update_ = state_provider.tasks_queue_.cur_frame_;
-        switch (item.mode_) {
-          case TBT::STEPWISE_1: {
-            TBT::State r = item.tree_();
-            if (r != TBT::BUSY) {
-              item.promise_.set_value(r);
-              if (item.values_) item.values_->set_done();
-              curr = queue.erase(curr);
-            }
-            break;
-          }
-          case TBT::STEPWISE_INF: {
-            item.tree_();
-            break;
-          }
-          case TBT::FULL_1: {
-            TBT::State r = TBT::State::SUCCESS;
-            while ((r = item.tree_()) != TBT::BUSY) {}
-            item.promise_.set_value(r);
-            if (item.values_) item.values_->set_done();
-            curr = queue.erase(curr);
-            break;
-          }
-          case TBT::FULL_INF: {
-            while ((item.tree_()) != TBT::BUSY) {}
-            break;
-          }
-        }
-        if (curr == queue.end()) break;
-      }
+  SECTION("static") {
+    States states;
+    auto step    = Execute::prepare_static<Variant, res>(states, -5);
+    size_t calls = 0;
+    State r      = BUSY;
+    while (r == BUSY) {
+      size_t steps = 100;
+      r            = step(steps);
+      calls++;
     }
+    REQUIRE(states.t_ == reference.t_);
+    REQUIRE(calls == 7);
   }
+}
 
-  REQUIRE(state_provider.t_[0] == "init [10]");
-  REQUIRE(state_provider.t_[1] == "run [10]");
-  REQUIRE(state_provider.t_[2] == "exit [10]");
+TEST_CASE("inline task slot", "[Compiler]") {
+  using Variant = std::variant<TaskA, TaskB, TaskC, TaskBig>;
 
-  REQUIRE(state_provider.t_[3] == "init [20]");
-  REQUIRE(state_provider.t_[4] == "run [20]");
-  REQUIRE(state_provider.t_[5] == "exit [20]");
+  {
+    constexpr std::string_view s = "TaskA[TaskB]";
+    constexpr auto res           = compile_static<compute_size_static<Variant>(s), Variant>(s);
+    const Header gh              = read_global_node_header(res);
+    REQUIRE(gh.slot_size_ == sizeof(TaskA));
+    REQUIRE(gh.slot_align_ == alignof(TaskA));
+    REQUIRE(gh.slot_offset_ + gh.slot_size_ + gh.slot_align_ - 1 == res.size());
+  }
 
-  REQUIRE(state_provider.t_[6] == "init [30]");
-  REQUIRE(state_provider.t_[7] == "run [30]");
-  REQUIRE(state_provider.t_[8] == "run [30]");
-  REQUIRE(state_provider.t_[9] == "run [30]");
-  REQUIRE(state_provider.t_[10] == "exit [30]");
+  {
+    // the slot is sized for the largest task referenced by the tree
+    constexpr std::string_view s = "TaskA[TaskC]";
+    constexpr auto res           = compile_static<compute_size_static<Variant>(s), Variant>(s);
+    const Header gh              = read_global_node_header(res);
+    REQUIRE(gh.slot_size_ == sizeof(TaskC));
+  }
 
-  REQUIRE(state_provider.t_[11] == "init [40]");
-  REQUIRE(state_provider.t_[12] == "run [40]");
-  REQUIRE(state_provider.t_[13] == "exit [40]");
+  {
+    // too large to be stored inline. only TaskBig is taken from the pool
+    constexpr std::string_view s = "TaskA[TaskBig]";
+    constexpr auto res           = compile_static<compute_size_static<Variant>(s), Variant>(s);
+    const Header gh              = read_global_node_header(res);
+    REQUIRE(gh.slot_size_ == sizeof(TaskA));
+    REQUIRE(gh.slot_align_ == alignof(TaskA));
+  }
+
+  {
+    constexpr std::string_view s = "TaskBig";
+    constexpr auto res           = compile_static<compute_size_static<Variant>(s), Variant>(s);
+    const Header gh              = read_global_node_header(res);
+    REQUIRE(gh.slot_size_ == 0);
+    REQUIRE(gh.slot_offset_ == 0);
+  }
 }
 
-TEST_CASE("co-routines", "[Execute]") {
-  using Variant1 = std::variant<TaskA, TaskB, TaskC, TaskD, TaskE>;
+TEST_CASE("hierarchy with inline task slot", "[Execute]") {
+  using Variant                = std::variant<TaskA, TaskB, TaskC>;
 
-  StateProvider<Variant1> state_provider;
+  constexpr std::string_view s = "TaskC, TaskA($0)[TaskB(5)[TaskA, TaskB]] TaskA[TaskC]";
+  constexpr size_t r_size      = compute_size_static<Variant>(s);
+  constexpr auto res           = compile_static<r_size, Variant>(s);
 
-  auto p = TBT_RUN(0, "TaskD($0)[TaskE($1)]", state_provider, STEPWISE_1, 10, 20);
+  struct States {
+    std::vector<std::string> t_;
+    TaskPool<Variant> task_pool_;
+  } states;
 
-  for (int32_t i = 0; i < 1000; ++i) { TBT_EXECUTE_QUEUE(state_provider) }
+  auto tree = res;
 
-  REQUIRE(state_provider.t_[0] == "co_await start [10]");
+  // TaskC is busy for a few steps. its state lives inside the tree
+  REQUIRE(Execute::execute_step<Variant>(tree, states, std::make_tuple(-5)) == BUSY);
+  {
+    const Header gh     = read_global_node_header(tree);
+    const NodeHeader nh = read_node_header({tree.begin() + gh.ptr_, tree.end()});
+    const Composite c   = read_composite(nh, {tree.begin() + gh.ptr_, tree.end()});
+    REQUIRE(c.ptr_ == Execute::in_slot);
+    REQUIRE(Execute::task_slot(gh, tree) >= tree.data() + gh.slot_offset_);
+  }
+
+  while (Execute::execute_step<Variant>(tree, states, std::make_tuple(-5)) == BUSY) {
+    //
+  }
+
+  REQUIRE(states.t_.size() == 25);
+
+  // the pool is not needed at all
+  REQUIRE(states.task_pool_.stats().allocated_ == 0);
+  REQUIRE(states.task_pool_.stats().reused_ == 0);
+}
+
+TEST_CASE("moving running prepared trees", "[Execute]") {
+  using Variant                = std::variant<TaskA, TaskC, TaskE>;
+
+  constexpr std::string_view s = "TaskC(7), TaskE(8)";
+  constexpr auto tree          = compile_static<compute_size_static<Variant>(s), Variant>(s);
+
+  struct States {
+    std::vector<std::string> t_;
+    TaskPool<Variant> task_pool_;
+  } states;
+
+  // TaskC is moved out of the slot of the first callable, the coroutine stays in its block of the pool. the moved from
+  // callables have no task left to exit
+  const auto check = [&](auto _step) {
+    REQUIRE(_step() == BUSY);
+    auto second = std::move(_step);
+    REQUIRE(second() == BUSY);
+    REQUIRE(second() == BUSY);
+    REQUIRE(second() == BUSY);
+    REQUIRE(second() == BUSY);
+    REQUIRE(states.t_.back() == "co_yield [8]");
+    auto third = std::move(second);
+    while (third() == BUSY) {
+      //
+    }
+  };
+
+  const std::vector<std::string> expected = {"init [7]",     "run [7]",      "run [7]",      "run [7]",     "exit [7]",
+                                             "co_yield [8]", "co_yield [8]", "co_yield [8]", "exit [8]"};
+
+  SECTION("dynamic") {
+    check(Execute::prepare<Variant>(tree, states));
+    REQUIRE(states.t_ == expected);
+    REQUIRE(states.task_pool_.stats().live_ == 0);
+  }
+
+  SECTION("static") {
+    check(Execute::prepare_static<Variant, tree>(states));
+    REQUIRE(states.t_ == expected);
+    REQUIRE(states.task_pool_.stats().live_ == 0);
+  }
+
+  SECTION("stopped in the middle") {
+    {
+      auto step = Execute::prepare<Variant>(tree, states);
+      step();
+      auto moved = std::move(step);
+    }
+    REQUIRE(states.t_ == std::vector<std::string>{"init [7]", "run [7]", "exit [7]"});
+  }
+}
+
+TEST_CASE("hierarchy with task pool", "[Execute]") {
+  using Variant                = std::variant<TaskA, TaskB, TaskC, TaskBig>;
+
+  constexpr std::string_view s = "TaskC, TaskA($0)[TaskB(5)[TaskA, TaskB]] TaskA[TaskC, TaskBig]";
+  constexpr size_t r_size      = compute_size_static<Variant>(s);
+  constexpr auto res           = compile_static<r_size, Variant>(s);
+
+  struct States {
+    std::vector<std::string> t_;
+    TaskPool<Variant> task_pool_;
+  } states;
+
+  auto tree = res;
+  while (Execute::execute_step<Variant>(tree, states, std::make_tuple(-5)) == BUSY) {
+    //
+  }
+
+  REQUIRE(states.t_.size() == 28);
+  REQUIRE(states.t_.back() == "exit [7]");
+
+  // only TaskBig is taken from the pool, the other tasks live in the slot of the tree
+  REQUIRE(states.task_pool_.stats().allocated_ == 1);
+  REQUIRE(states.task_pool_.stats().reused_ == 0);
+  REQUIRE(states.task_pool_.stats().live_ == 0);
+}
+
+template <class Variant_>
+struct StateProvider {
+  using Variant = Variant_;
+  std::vector<std::string> t_;
+
+  TBT::TaskQueue<> tasks_queue_;
+};
+
+// brings its own pool for coroutine frames
+template <class Variant_>
+struct FrameProvider {
+  using Variant = Variant_;
+  std::vector<std::string> t_;
+
+  TBT::FramePool<> frame_pool_;
+  TBT::TaskQueue<> tasks_queue_;
+};
+
+// hands out the awaitables of TaskWait
+template <class Variant_>
+struct WaitProvider {
+  using Variant = Variant_;
+  std::vector<std::string> t_;
+  std::array<Execute::CoStateValues*, 4> waiting_{};
+
+  TBT::TaskQueue<> tasks_queue_;
+};
+
+// the channel outlives the trees in the queue
+template <class Variant_>
+struct EventProvider {
+  using Variant = Variant_;
+  std::vector<std::string> t_;
+  TBT::EventChannel<int32_t> events_;
+
+  TBT::TaskQueue<> tasks_queue_;
+};
+
+// everything a cancelled tree can hold on to. the queue is destroyed first
+template <class Variant_>
+struct CancelProvider {
+  using Variant = Variant_;
+  std::vector<std::string> t_;
+  TBT::EventChannel<int32_t> events_;
+  TBT::FramePool<> frame_pool_;
+  TBT::ExecutionItem* victim_ = nullptr;
+
+  TBT::TaskQueue<> tasks_queue_;
+};
+
+TEST_CASE("legacy", "[Execute]") {
+  using Variant1 = std::variant<TaskA, TaskB, TaskC, TaskD, TaskE>;
+
+  StateProvider<Variant1> state_provider;
+
+  // auto p = TBT_RUN(0, "TaskA($0)[TaskB($1), TaskC($2)] TaskA($3)", sp, STEPWISE_1, 10, 20, 30, 40);
+
+  auto p = [&]() -> auto {
+    TBT::ExecutionItem& item = state_provider.tasks_queue_.emplace(0);
+    item.mode_               = STEPWISE_1;
+    item.tree_ = TBT_COMPILE_AND_PREPARE("TaskA($0)[TaskB($1), TaskC($2)] TaskA($3)", state_provider, 10, 20, 30, 40);
+    return TBT::TreeAwaitable<TBT::ExecutionItem>(&item);
+  }();
+
+  for (int32_t i = 0; i < 1000; ++i) state_provider.tasks_queue_.execute();
+
+  REQUIRE(p.done());
+  REQUIRE(state_provider.tasks_queue_.size() == 1);
+  p.release();
+  TBT_EXECUTE_QUEUE(state_provider)
+  REQUIRE(state_provider.tasks_queue_.empty());
+
+  REQUIRE(state_provider.t_[0] == "init [10]");
+  REQUIRE(state_provider.t_[1] == "run [10]");
+  REQUIRE(state_provider.t_[2] == "exit [10]");
+
+  REQUIRE(state_provider.t_[3] == "init [20]");
+  REQUIRE(state_provider.t_[4] == "run [20]");
+  REQUIRE(state_provider.t_[5] == "exit [20]");
+
+  REQUIRE(state_provider.t_[6] == "init [30]");
+  REQUIRE(state_provider.t_[7] == "run [30]");
+  REQUIRE(state_provider.t_[8] == "run [30]");
+  REQUIRE(state_provider.t_[9] == "run [30]");
+  REQUIRE(state_provider.t_[10] == "exit [30]");
+
+  REQUIRE(state_provider.t_[11] == "init [40]");
+  REQUIRE(state_provider.t_[12] == "run [40]");
+  REQUIRE(state_provider.t_[13] == "exit [40]");
+}
+
+TEST_CASE("co-routines", "[Execute]") {
+  using Variant1 = std::variant<TaskA, TaskB, TaskC, TaskD, TaskE>;
+
+  StateProvider<Variant1> state_provider;
+
+  auto p = TBT_RUN(0, "TaskD($0)[TaskE($1)]", state_provider, STEPWISE_1, 10, 20);
+
+  for (int32_t i = 0; i < 1000; ++i) { TBT_EXECUTE_QUEUE(state_provider) }
+
+  REQUIRE(state_provider.t_[0] == "co_await start [10]");
 
   REQUIRE(state_provider.t_[1] == "co_yield [50]");
   REQUIRE(state_provider.t_[2] == "co_yield [50]");
@@ -1179,6 +1749,661 @@ TEST_CASE("co-routines", "[Execute]") {
   REQUIRE(state_provider.t_[10] == "exit [20]");
 }
 
+TEST_CASE("pooled coroutine frames", "[Execute]") {
+  using Variant1 = std::variant<TaskA, TaskB, TaskC, TaskD, TaskE, TaskQuick>;
+
+  SECTION("thread-local pool") {
+    StateProvider<Variant1> sp;
+    const FramePool<>& pool = FramePool<>::local();
+    const size_t live       = pool.stats().live_;
+
+    TBT_RUN(0, "TaskE, TaskQuick", sp, STEPWISE_1);
+    for (int32_t i = 0; i < 10; ++i) { TBT_EXECUTE_QUEUE(sp) }
+    REQUIRE(pool.stats().live_ == live);
+
+    // the second run only takes frames from the free lists
+    const PoolStats first = pool.stats();
+    TBT_RUN(0, "TaskE, TaskQuick", sp, STEPWISE_1);
+    for (int32_t i = 0; i < 10; ++i) { TBT_EXECUTE_QUEUE(sp) }
+    REQUIRE(pool.stats().live_ == live);
+    REQUIRE(pool.stats().allocated_ == first.allocated_);
+    REQUIRE(pool.stats().reused_ == first.reused_ + 2);
+    REQUIRE(sp.t_.back() == "co_return [60]");
+  }
+
+  SECTION("pool of the StateProvider") {
+    FrameProvider<Variant1> sp;
+
+    TBT_RUN(0, "TaskD[TaskQuick], TaskQuick", sp, STEPWISE_1);
+    TBT_RUN_STATIC(0, "TaskE, TaskQuick", sp, STEPWISE_1);
+    for (int32_t i = 0; i < 20; ++i) { TBT_EXECUTE_QUEUE(sp) }
+    REQUIRE(sp.frame_pool_.stats().live_ == 0);
+    REQUIRE(sp.frame_pool_.stats().allocated_ > 0);
+
+    const PoolStats first = sp.frame_pool_.stats();
+    TBT_RUN(0, "TaskD[TaskQuick], TaskQuick", sp, STEPWISE_1);
+    TBT_RUN_STATIC(0, "TaskE, TaskQuick", sp, STEPWISE_1);
+    for (int32_t i = 0; i < 20; ++i) { TBT_EXECUTE_QUEUE(sp) }
+    REQUIRE(sp.frame_pool_.stats().live_ == 0);
+    REQUIRE(sp.frame_pool_.stats().allocated_ == first.allocated_);
+    REQUIRE(std::ranges::count(sp.t_, "exit [40]") == 2);
+  }
+}
+
+TEST_CASE("budgeted queue", "[Execute]") {
+  using Variant1 = std::variant<TaskA>;
+
+  StateProvider<Variant1> sp;
+
+  // the values of the TaskAs that ran since the last call
+  const auto ran = [&sp]() {
+    std::vector<int32_t> out;
+    for (const std::string& s : sp.t_)
+      if (s.starts_with("init")) out.push_back(std::stoi(s.substr(6)));
+    sp.t_.clear();
+    return out;
+  };
+
+  SECTION("carry-over") {
+    for (int32_t i = 0; i < 10; ++i) TBT_RUN(0, "TaskA($0)", sp, STEPWISE_INF, i);
+
+    TBT::Budget budget{.steps_ = 4};
+    TBT_EXECUTE_QUEUE_BUDGET(sp, budget)
+    REQUIRE(ran() == std::vector<int32_t>{0, 1, 2, 3});
+    REQUIRE(budget.used_steps_ == 4);
+    REQUIRE(budget.deferred_ == 6);
+
+    TBT_EXECUTE_QUEUE_BUDGET(sp, budget)
+    REQUIRE(ran() == std::vector<int32_t>{4, 5, 6, 7});
+    TBT_EXECUTE_QUEUE_BUDGET(sp, budget)
+    REQUIRE(ran() == std::vector<int32_t>{8, 9, 0, 1});
+    REQUIRE(sp.tasks_queue_.size() == 10);
+  }
+
+  SECTION("aging") {
+    TBT_RUN(0, "TaskA($0)", sp, STEPWISE_INF, 0);
+    for (int32_t i = 1; i < 5; ++i) TBT_RUN(1, "TaskA($0)", sp, STEPWISE_INF, i);
+
+    TBT::Budget budget{.steps_ = 4, .max_age_ = 2};
+    TBT_EXECUTE_QUEUE_BUDGET(sp, budget)
+    REQUIRE(ran() == std::vector<int32_t>{1, 2, 3, 4});
+    TBT_EXECUTE_QUEUE_BUDGET(sp, budget)
+    REQUIRE(ran() == std::vector<int32_t>{1, 2, 3, 4});
+    REQUIRE(budget.deferred_ == 1);
+
+    // 0 has waited for 3 frames
+    TBT_EXECUTE_QUEUE_BUDGET(sp, budget)
+    REQUIRE(ran() == std::vector<int32_t>{0, 1, 2, 3});
+    TBT_EXECUTE_QUEUE_BUDGET(sp, budget)
+    REQUIRE(ran() == std::vector<int32_t>{4, 1, 2, 3});
+  }
+
+  SECTION("full modes are interrupted") {
+    auto p = TBT_RUN(0, "TaskA(1), TaskA(2), TaskA(3), TaskA(4)", sp, FULL_1);
+
+    TBT::Budget budget{.steps_ = 2};
+    TBT_EXECUTE_QUEUE_BUDGET(sp, budget)
+    REQUIRE(ran() == std::vector<int32_t>{1, 2});
+    REQUIRE(!p.done());
+    TBT_EXECUTE_QUEUE_BUDGET(sp, budget)
+    REQUIRE(ran() == std::vector<int32_t>{3, 4});
+
+    for (int32_t i = 0; i < 2 && !p.done(); ++i) { TBT_EXECUTE_QUEUE_BUDGET(sp, budget) }
+    REQUIRE(p.done());
+    REQUIRE(ran().empty());
+  }
+
+  SECTION("deadline") {
+    for (int32_t i = 0; i < 3; ++i) TBT_RUN(0, "TaskA($0)", sp, STEPWISE_INF, i);
+
+    // an expired deadline still makes one step per frame
+    TBT::Budget budget{.deadline_ = TBT::Budget::Clock::now()};
+    TBT_EXECUTE_QUEUE_BUDGET(sp, budget)
+    REQUIRE(ran() == std::vector<int32_t>{0});
+    REQUIRE(budget.deferred_ == 2);
+    TBT_EXECUTE_QUEUE_BUDGET(sp, budget)
+    REQUIRE(ran() == std::vector<int32_t>{1});
+
+    budget.deadline_ = TBT::Budget::Clock::now() + std::chrono::seconds(10);
+    TBT_EXECUTE_QUEUE_BUDGET(sp, budget)
+    REQUIRE(ran() == std::vector<int32_t>{2, 0, 1});
+    REQUIRE(budget.deferred_ == 0);
+  }
+
+  SECTION("woken items are not starving") {
+    StateProvider<std::variant<TaskA, TaskSleep>> sq;
+    TBT_RUN(0, "TaskSleep(4)", sq, STEPWISE_INF);
+    TBT_RUN(0, "TaskA($0)", sq, STEPWISE_INF, 1);
+
+    // one step per frame. the sleeper is parked for longer than max_age_ frames
+    TBT::Budget budget{.steps_ = 1, .max_age_ = 2};
+    TBT_EXECUTE_QUEUE_BUDGET(sq, budget)
+    REQUIRE(sq.tasks_queue_.parked() == 1);
+    for (int32_t i = 0; i < 10 && sq.tasks_queue_.parked() == 1; ++i) {
+      sq.t_.clear();
+      TBT_EXECUTE_QUEUE_BUDGET(sq, budget)
+    }
+
+    // the frame it woke up in. it waits behind the tree that ran in the last frame
+    REQUIRE(sq.tasks_queue_.parked() == 0);
+    REQUIRE(std::ranges::count(sq.t_, "init [1]") == 1);
+    REQUIRE(std::ranges::count(sq.t_, "slept [4]") == 0);
+    REQUIRE(budget.deferred_ == 1);
+
+    sq.t_.clear();
+    TBT_EXECUTE_QUEUE_BUDGET(sq, budget)
+    REQUIRE(sq.t_.front() == "slept [4]");
+  }
+}
+
+TEST_CASE("tree quotas", "[Execute]") {
+  using Variant1 = std::variant<TaskA>;
+
+  StateProvider<Variant1> sp;
+
+  const auto ran = [&sp]() {
+    std::vector<int32_t> out;
+    for (const std::string& s : sp.t_)
+      if (s.starts_with("init")) out.push_back(std::stoi(s.substr(6)));
+    sp.t_.clear();
+    return out;
+  };
+
+  SECTION("stepwise n") {
+    auto p = TBT_RUN_SLICED(0, "TaskA(1), TaskA(2), TaskA(3), TaskA(4), TaskA(5)", sp, STEPWISE_1, TBT::Quota{3});
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(ran() == std::vector<int32_t>{1, 2, 3});
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(ran() == std::vector<int32_t>{4, 5});
+
+    for (int32_t i = 0; i < 2 && !p.done(); ++i) { TBT_EXECUTE_QUEUE(sp) }
+    REQUIRE(p.done());
+  }
+
+  SECTION("changed at runtime") {
+    auto p = TBT_RUN(0, "TaskA(1), TaskA(2), TaskA(3), TaskA(4), TaskA(5)", sp, STEPWISE_1);
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(ran() == std::vector<int32_t>{1});
+
+    p.set_quota(TBT::Quota{.steps_ = 2});
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(ran() == std::vector<int32_t>{2, 3});
+
+    p.set_quota(TBT::Quota{});
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(ran() == std::vector<int32_t>{4});
+  }
+
+  SECTION("full modes are capped") {
+    TBT_RUN_SLICED(0, "TaskA(1), TaskA(2), TaskA(3)", sp, FULL_INF, TBT::Quota{2});
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(ran() == std::vector<int32_t>{1, 2});
+    REQUIRE(sp.tasks_queue_.size() == 1);
+  }
+
+  SECTION("time slice") {
+    // a generous slice lets a stepwise tree finish in one frame
+    auto p = TBT_RUN_SLICED(0, "TaskA(1), TaskA(2), TaskA(3)", sp, STEPWISE_1,
+                            (TBT::Quota{.steps_ = 100, .time_ = std::chrono::seconds(10)}));
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(ran() == std::vector<int32_t>{1, 2, 3});
+    REQUIRE(p.done());
+  }
+}
+
+TEST_CASE("full modes end at a waiting task", "[Execute]") {
+  using Variant1 = std::variant<TaskA, TaskC>;
+
+  StateProvider<Variant1> sp;
+
+  // TaskC stays BUSY for three frames. every frame runs it once and ends
+  const auto frames = [&sp](const TBT::ExecutionMode _mode, const TBT::Quota _quota) {
+    auto p = TBT_RUN_SLICED(0, "TaskA(1), TaskC, TaskA(2)", sp, _mode, _quota);
+    std::vector<size_t> runs;
+    for (int32_t i = 0; i < 4; ++i) {
+      TBT_EXECUTE_QUEUE(sp)
+      runs.push_back(static_cast<size_t>(std::ranges::count(sp.t_, "run [3]")));
+      sp.t_.clear();
+    }
+    return std::make_pair(runs, p.done());
+  };
+
+  SECTION("FULL_1") {
+    const auto [runs, done] = frames(TBT::FULL_1, TBT::Quota{});
+    REQUIRE(runs == std::vector<size_t>{1, 1, 1, 0});
+    REQUIRE(done);
+  }
+
+  SECTION("FULL_INF") {
+    const auto [runs, done] = frames(TBT::FULL_INF, TBT::Quota{});
+    REQUIRE(runs == std::vector<size_t>{1, 1, 1, 0});
+    REQUIRE(!done);
+  }
+
+  SECTION("time slice") {
+    const auto [runs, done] = frames(TBT::FULL_1, TBT::Quota{.time_ = std::chrono::seconds(10)});
+    REQUIRE(runs == std::vector<size_t>{1, 1, 1, 0});
+    REQUIRE(done);
+  }
+
+  SECTION("budget with a deadline") {
+    auto p = TBT_RUN(0, "TaskA(1), TaskC, TaskA(2)", sp, FULL_1);
+    TBT::Budget budget{.deadline_ = TBT::Budget::Clock::now() + std::chrono::seconds(10)};
+    TBT_EXECUTE_QUEUE_BUDGET(sp, budget)
+    REQUIRE(std::ranges::count(sp.t_, "run [3]") == 1);
+    REQUIRE(budget.used_steps_ == 2);
+    REQUIRE(!p.done());
+  }
+}
+
+TEST_CASE("parked trees", "[Execute]") {
+  using Variant1 = std::variant<TaskA, TaskB, TaskC, TaskD, TaskE, TaskWait>;
+
+  SECTION("woken by set_done") {
+    WaitProvider<Variant1> sp;
+    TBT_RUN(0, "TaskWait(0)", sp, STEPWISE_1);
+    TBT_RUN(0, "TaskWait(1)", sp, STEPWISE_1);
+
+    // both trees are off the active list until their awaitable is done
+    for (int32_t i = 0; i < 10; ++i) { TBT_EXECUTE_QUEUE(sp) }
+    REQUIRE(sp.tasks_queue_.parked() == 2);
+    REQUIRE(sp.tasks_queue_.size() == 2);
+    REQUIRE(sp.t_.size() == 2);
+
+    sp.waiting_[1]->set_done();
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(sp.t_.back() == "woken [1]");
+    REQUIRE(sp.tasks_queue_.parked() == 1);
+    REQUIRE(sp.tasks_queue_.size() == 1);
+
+    sp.waiting_[0]->set_done();
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(sp.t_.back() == "woken [0]");
+    REQUIRE(sp.tasks_queue_.empty());
+  }
+
+  SECTION("awaiting a tree in FULL mode") {
+    WaitProvider<Variant1> sp;
+    TBT_RUN(0, "TaskD", sp, FULL_1);
+    for (int32_t i = 0; i < 10; ++i) { TBT_EXECUTE_QUEUE(sp) }
+
+    REQUIRE(sp.tasks_queue_.empty());
+    REQUIRE(sp.t_.size() == 7);
+    REQUIRE(sp.t_[4] == "exit [50]");
+    REQUIRE(sp.t_[5] == "co_await end [40]");
+  }
+
+  SECTION("woken from another thread") {
+    WaitProvider<Variant1> sp;
+    TBT::WorkerPool pool(2);
+    auto h = TBT_RUN(0, "TaskWait(0)", sp, STEPWISE_1);
+    TBT_EXECUTE_QUEUE_PARALLEL(sp, pool)
+    REQUIRE(sp.tasks_queue_.parked() == 1);
+
+    std::thread io([&]() { sp.waiting_[0]->set_done(); });
+    while (!h.done()) { TBT_EXECUTE_QUEUE_PARALLEL(sp, pool) }
+    io.join();
+    REQUIRE(sp.t_.back() == "woken [0]");
+  }
+}
+
+TEST_CASE("TimerWheel", "[Execute]") {
+  TimerWheel wheel;
+
+  // every level and beyond the range of the wheel
+  std::vector<uint64_t> dues = {1, 2, 63, 64, 65, 100, 4095, 4096, 4097, 70000, 262143, 262144, 300000, 16777217};
+  std::vector<Execute::Timer> timers(dues.size());
+  for (size_t i = 0; i < dues.size(); ++i) {
+    timers[i].due_ = dues[i];
+    wheel.insert(timers[i]);
+  }
+  wheel.remove(timers[5]);
+  REQUIRE(wheel.size() == dues.size() - 1);
+
+  std::vector<uint64_t> fired;
+  for (uint64_t tick = 1; tick < 16777217 + 7; tick += 7) {
+    wheel.advance(tick, [&](Execute::Timer& _t) {
+      REQUIRE(_t.due_ <= wheel.now());
+      REQUIRE(wheel.now() - _t.due_ < 7);
+      fired.push_back(_t.due_);
+    });
+  }
+  dues.erase(dues.begin() + 5);
+  REQUIRE(fired == dues);
+  REQUIRE(wheel.size() == 0);
+}
+
+TEST_CASE("Timers - sleeping after a long idle time", "[Execute]") {
+  constexpr uint64_t hour = 3600000;
+  Execute::Parking p;
+
+  // the empty wheel follows the clock every frame
+  {
+    Timers timers;
+    timers.start_ -= std::chrono::hours(1);
+    timers.advance(1);
+    REQUIRE(timers.time_.now() >= hour);
+  }
+
+  // no frame ran in between. the first timer moves the wheel to now, advancing does not walk the idle hour
+  {
+    Timers timers;
+    timers.start_ -= std::chrono::hours(1);
+    timers.sleep_for(p, std::chrono::milliseconds(5));
+    REQUIRE(timers.time_.now() >= hour);
+    REQUIRE(p.timer_.due_ - timers.time_.now() == 5);
+    timers.cancel(p.timer_);
+    REQUIRE(timers.size() == 0);
+  }
+}
+
+TEST_CASE("sleeping trees", "[Execute]") {
+  using Variant1 = std::variant<TaskSleep, TaskNap>;
+
+  SECTION("frames") {
+    StateProvider<Variant1> sp;
+    TBT_RUN(0, "TaskSleep(3)", sp, STEPWISE_1);
+    TBT_RUN(0, "TaskNap(2)", sp, STEPWISE_1);
+
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(sp.tasks_queue_.sleeping() == 2);
+    REQUIRE(sp.tasks_queue_.parked() == 2);
+
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(sp.t_ == std::vector<std::string>{"sleep [3]", "nap [2]"});
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(sp.t_.back() == "woke up [2]");
+    REQUIRE(sp.tasks_queue_.sleeping() == 1);
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(sp.t_.back() == "slept [3]");
+    REQUIRE(sp.tasks_queue_.empty());
+  }
+
+  SECTION("milliseconds") {
+    StateProvider<Variant1> sp;
+    const auto start = std::chrono::steady_clock::now();
+    TBT_RUN(0, "TaskSleep(1, 5)", sp, STEPWISE_1);
+
+    int32_t frames = 0;
+    while (!sp.tasks_queue_.empty()) {
+      TBT_EXECUTE_QUEUE(sp)
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      frames++;
+    }
+    REQUIRE(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(5));
+    REQUIRE(frames > 2);
+    REQUIRE(sp.t_.back() == "slept [1]");
+  }
+
+  SECTION("outside of a queue") {
+    struct States {
+      std::vector<std::string> t_;
+    } states;
+    constexpr auto tree = compile_static<compute_size_static<Variant1>("TaskSleep(5)"), Variant1>("TaskSleep(5)");
+    auto step           = Execute::prepare_static<Variant1, tree>(states);
+    REQUIRE(step() == BUSY);
+    REQUIRE(step() == SUCCESS);
+  }
+}
+
+TEST_CASE("inline subtrees", "[Execute]") {
+  using Variant1 = std::variant<TaskNest>;
+
+  SECTION("a chain finishes in one frame") {
+    StateProvider<Variant1> sp;
+    auto p = TBT_RUN(0, "TaskNest(3)", sp, STEPWISE_1);
+
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(p.done());
+    REQUIRE(sp.t_ == std::vector<std::string>{"nest [3]", "nest [2]", "nest [1]", "nest [0]", "nested [0]",
+                                              "nested [1]", "nested [2]", "nested [3]"});
+    p.release();
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(sp.tasks_queue_.empty());
+  }
+
+  SECTION("a waiting subtree falls back to the queue") {
+    StateProvider<Variant1> sp;
+    TBT_RUN(0, "TaskNest(2, 2)", sp, STEPWISE_1);
+
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(sp.t_ == std::vector<std::string>{"nest [2]", "nest [1]", "nest [0]"});
+    REQUIRE(sp.tasks_queue_.sleeping() == 1);
+
+    for (int32_t i = 0; i < 8 && !sp.tasks_queue_.empty(); ++i) { TBT_EXECUTE_QUEUE(sp) }
+    REQUIRE(sp.tasks_queue_.empty());
+    REQUIRE(sp.t_ ==
+            std::vector<std::string>{"nest [2]", "nest [1]", "nest [0]", "nested [0]", "nested [1]", "nested [2]"});
+  }
+
+  SECTION("a yielding subtree falls back to the queue") {
+    StateProvider<Variant1> sp;
+    TBT_RUN(0, "TaskNest(1, -2)", sp, STEPWISE_1);
+
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(sp.t_ == std::vector<std::string>{"nest [1]", "nest [0]"});
+
+    for (int32_t i = 0; i < 8 && !sp.tasks_queue_.empty(); ++i) { TBT_EXECUTE_QUEUE(sp) }
+    REQUIRE(sp.tasks_queue_.empty());
+    REQUIRE(sp.t_ == std::vector<std::string>{"nest [1]", "nest [0]", "nested [0]", "nested [1]"});
+  }
+
+  SECTION("the frame budget is shared") {
+    StateProvider<Variant1> sp;
+    TBT_RUN(0, "TaskNest(3)", sp, STEPWISE_1);
+
+    TBT::Budget budget{.steps_ = 2};
+    sp.tasks_queue_.execute(budget);
+    REQUIRE(sp.t_ == std::vector<std::string>{"nest [3]", "nest [2]"});
+    REQUIRE(budget.used_steps_ == 2);
+
+    for (int32_t i = 0; i < 16 && !sp.tasks_queue_.empty(); ++i) { TBT_EXECUTE_QUEUE(sp) }
+    REQUIRE(sp.tasks_queue_.empty());
+    REQUIRE(sp.t_.back() == "nested [3]");
+  }
+}
+
+TEST_CASE("event channels", "[Execute]") {
+  using Variant1 = std::variant<TaskA, TaskListen, TaskGuard>;
+
+  SECTION("fan-out") {
+    EventProvider<Variant1> sp;
+    TBT_RUN(0, "TaskListen(1)", sp, STEPWISE_1);
+    TBT_RUN(0, "TaskGuard(1)", sp, STEPWISE_1);
+    TBT_RUN(0, "TaskListen(2)", sp, STEPWISE_1);
+
+    for (int32_t i = 0; i < 10; ++i) { TBT_EXECUTE_QUEUE(sp) }
+    REQUIRE(sp.events_.size() == 3);
+    REQUIRE(sp.tasks_queue_.parked() == 3);
+    REQUIRE(sp.t_.empty());
+
+    // every subscriber of 1 wakes up in the next frame
+    REQUIRE(sp.events_.dispatch(1, 42) == 2);
+    REQUIRE(sp.events_.dispatch(1, 43) == 0);
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(sp.t_ == std::vector<std::string>{"heard [1] 42", "alarm [1] 42"});  // in the order they subscribed
+    REQUIRE(sp.tasks_queue_.size() == 1);
+
+    REQUIRE(sp.events_.dispatch(2, 7) == 1);
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(sp.t_.back() == "heard [2] 7");
+    REQUIRE(sp.tasks_queue_.empty());
+  }
+
+  SECTION("outside of a queue") {
+    using Variant2 = std::variant<TaskGuard>;
+    EventProvider<Variant2> sp;
+    auto step = TBT_COMPILE_AND_PREPARE("TaskGuard(3)", sp);
+    REQUIRE(step() == BUSY);
+    REQUIRE(step() == BUSY);
+    REQUIRE(sp.events_.size() == 1);
+
+    sp.events_.dispatch(3, 5);
+    REQUIRE(step() == SUCCESS);
+    REQUIRE(sp.t_.back() == "alarm [3] 5");
+  }
+
+  SECTION("subscription destroyed while waiting") {
+    TBT::EventChannel<> events;
+    {
+      TBT::EventChannel<>::Subscription sub;
+      REQUIRE(events.wait(4, sub) == BUSY);
+      REQUIRE(events.wait(4, sub) == BUSY);
+      REQUIRE(events.size() == 1);
+    }
+    REQUIRE(events.size() == 0);
+    REQUIRE(events.dispatch(4) == 0);
+    REQUIRE(events.waiters_.empty());
+  }
+
+  SECTION("waiting for another id") {
+    TBT::EventChannel<> events;
+    TBT::EventChannel<>::Subscription sub, other;
+    REQUIRE(events.wait(4, sub) == BUSY);
+    REQUIRE(events.wait(4, other) == BUSY);
+    REQUIRE(events.wait(5, sub) == BUSY);
+    REQUIRE(events.size() == 2);
+
+    // sub moved over to 5, other is still the only subscriber of 4
+    REQUIRE(events.dispatch(4) == 1);
+    REQUIRE(other.fired());
+    REQUIRE(!sub.fired());
+    REQUIRE(events.dispatch(5) == 1);
+    REQUIRE(sub.fired());
+
+    // nothing is left behind for ids without subscribers
+    REQUIRE(events.size() == 0);
+    REQUIRE(events.waiters_.empty());
+  }
+}
+
+TEST_CASE("cancellation", "[Execute]") {
+  using Variant1 = std::variant<TaskA, TaskC, TaskD, TaskE, TaskSleep, TaskListen, TaskGuard, TaskAbort, TaskOuter>;
+
+  CancelProvider<Variant1> sp;
+
+  SECTION("legacy task") {
+    auto p = TBT_RUN(0, "TaskC(3)[TaskA]", sp, STEPWISE_1);
+    TBT_EXECUTE_QUEUE(sp)
+    p.cancel();
+    REQUIRE(sp.t_ == std::vector<std::string>{"init [3]", "run [3]", "exit [3]"});
+    REQUIRE(p.done());
+    REQUIRE(p.await_resume() == CANCELLED);
+
+    // the item stays until the handle is gone, cancelling twice does nothing
+    p.cancel();
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(sp.tasks_queue_.size() == 1);
+    p.release();
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(sp.tasks_queue_.size() == 0);
+    REQUIRE(sp.t_.size() == 3);
+  }
+
+  SECTION("coroutine") {
+    auto p = TBT_RUN(0, "TaskE", sp, STEPWISE_1);
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(sp.frame_pool_.stats().live_ == 1);
+    p.cancel();
+    REQUIRE(sp.frame_pool_.stats().live_ == 0);
+    REQUIRE(sp.t_.back() == "exit [50]");
+  }
+
+  SECTION("static engine") {
+    auto p = TBT_RUN_STATIC(0, "TaskA, TaskE", sp, STEPWISE_1);
+    for (int32_t i = 0; i < 3; ++i) { TBT_EXECUTE_QUEUE(sp) }
+    REQUIRE(sp.frame_pool_.stats().live_ == 1);
+    p.cancel();
+    REQUIRE(sp.frame_pool_.stats().live_ == 0);
+    REQUIRE(sp.t_.back() == "exit [50]");
+    REQUIRE(p.await_resume() == CANCELLED);
+  }
+
+  SECTION("sleeping and parked") {
+    auto p = TBT_RUN(0, "TaskSleep(100)", sp, STEPWISE_1);
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(sp.tasks_queue_.sleeping() == 1);
+    REQUIRE(sp.tasks_queue_.parked() == 1);
+
+    p.cancel();
+    p.release();
+    REQUIRE(sp.tasks_queue_.sleeping() == 0);
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(sp.tasks_queue_.parked() == 0);
+    REQUIRE(sp.tasks_queue_.size() == 0);
+  }
+
+  SECTION("waiting for events") {
+    auto a = TBT_RUN(0, "TaskListen(1)", sp, STEPWISE_1);
+    auto b = TBT_RUN(0, "TaskGuard(1)", sp, STEPWISE_1);
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(sp.events_.size() == 2);
+
+    a.cancel();
+    b.cancel();
+    REQUIRE(sp.events_.size() == 0);
+    REQUIRE(sp.events_.dispatch(1, 5) == 0);
+  }
+
+  SECTION("awaited trees are released") {
+    auto p = TBT_RUN(0, "TaskD", sp, STEPWISE_1);
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(sp.tasks_queue_.size() == 2);
+
+    p.cancel();
+    REQUIRE(sp.t_.back() == "exit [40]");
+    for (int32_t i = 0; i < 5; ++i) { TBT_EXECUTE_QUEUE(sp) }
+    REQUIRE(sp.tasks_queue_.size() == 1);
+  }
+
+  SECTION("from inside a task") {
+    auto other = TBT_RUN(0, "TaskC(3)", sp, STEPWISE_1);
+    TBT_EXECUTE_QUEUE(sp)
+    sp.victim_ = other.ref_;
+    auto p     = TBT_RUN(0, "TaskAbort", sp, STEPWISE_1);
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(other.await_resume() == CANCELLED);
+    REQUIRE(sp.t_.back() == "exit [3]");
+    REQUIRE(sp.t_[sp.t_.size() - 2] == "abort");
+
+    // the own tree stops once the task has returned
+    sp.t_.clear();
+    auto self  = TBT_RUN(0, "TaskAbort, TaskA", sp, FULL_1);
+    sp.victim_ = self.ref_;
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(self.await_resume() == CANCELLED);
+    REQUIRE(sp.t_ == std::vector<std::string>{"abort"});
+  }
+
+  SECTION("from inside an inline subtree") {
+    // the outer tree is on the stack below the subtree. it is unwound once TaskOuter has returned, the subtree runs on
+    auto outer = TBT_RUN(0, "TaskOuter, TaskA", sp, FULL_1);
+    sp.victim_ = outer.ref_;
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(outer.await_resume() == CANCELLED);
+    REQUIRE(sp.t_ ==
+            std::vector<std::string>{"outer", "abort", "init [1]", "run [1]", "exit [1]", "inner done", "exit outer"});
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(sp.t_.size() == 7);
+  }
+
+  SECTION("prepared trees clean up after themselves") {
+    {
+      auto tree = TBT_COMPILE_AND_PREPARE("TaskC(3)", sp);
+      REQUIRE(tree() == BUSY);
+    }
+    REQUIRE(sp.t_.back() == "exit [3]");
+
+    {
+      auto tree = TBT_COMPILE_AND_PREPARE_STATIC("TaskE", sp);
+      REQUIRE(tree() == BUSY);
+      REQUIRE(sp.frame_pool_.stats().live_ == 1);
+    }
+    REQUIRE(sp.frame_pool_.stats().live_ == 0);
+    REQUIRE(sp.t_.back() == "exit [50]");
+  }
+}
+
 TEST_CASE("mixed", "[Execute]") {
   using Variant1 = std::variant<TaskA, TaskB, TaskC, TaskD, TaskE>;
 
@@ -1196,4 +2421,569 @@ TEST_CASE("mixed", "[Execute]") {
   REQUIRE(sp.t_[4] == "co_yield [20]");
   REQUIRE(sp.t_[5] == "co_yield [20]");
   REQUIRE(sp.t_[6] == "exit [20]");
+}
+
+TEST_CASE("static layout", "[Execute]") {
+  using Variant                = std::variant<TaskA, TaskB, TaskC>;
+
+  constexpr std::string_view s = "TaskC, TaskA($0)[TaskB(5)[TaskA, TaskB]] TaskA[TaskC]";
+  constexpr auto tree          = compile_static<compute_size_static<Variant>(s), Variant>(s);
+  using Layout                 = Execute::StaticLayout<tree>;
+
+  STATIC_REQUIRE(Layout::node_count == 7);
+  STATIC_REQUIRE(Layout::root_children == std::array<uint32_t, 3>{0, 1, 5});
+  STATIC_REQUIRE(Layout::parents == std::array<uint32_t, 7>{7, 7, 1, 2, 2, 7, 5});
+  STATIC_REQUIRE(Layout::children == std::array<uint32_t, 4>{2, 3, 4, 6});
+  STATIC_REQUIRE(Layout::next == std::array<uint32_t, 7>{1, 5, 5, 4, 5, 7, 7});
+  STATIC_REQUIRE(Layout::nodes[6].type_idx_ == 2);
+  STATIC_REQUIRE(Layout::slot_layout<Variant>().first == sizeof(TaskC));
+}
+
+TEST_CASE("static hierarchy", "[Execute]") {
+  using Variant                = std::variant<TaskA, TaskB, TaskC>;
+
+  constexpr std::string_view s = "TaskC, TaskA($0)[TaskB(5)[TaskA, TaskB]] TaskA[TaskC]";
+  constexpr auto tree          = compile_static<compute_size_static<Variant>(s), Variant>(s);
+
+  struct States {
+    std::vector<std::string> t_;
+  } states;
+
+  // the dynamic engine runs the same tree
+  States expected;
+  auto dynamic_tree = tree;
+
+  size_t expected_steps = 1;
+  while (Execute::execute_step<Variant>(dynamic_tree, expected, std::make_tuple(-5)) == BUSY) expected_steps++;
+
+  auto step = Execute::prepare_static<Variant, tree>(states, -5);
+  for (int32_t pass = 0; pass < 2; ++pass) {
+    states.t_.clear();
+    size_t steps = 1;
+    while (step() == BUSY) steps++;
+
+    REQUIRE(steps == expected_steps);
+    REQUIRE(states.t_ == expected.t_);
+  }
+}
+
+TEST_CASE("tree instances", "[Execute]") {
+  using Variant  = std::variant<TaskA, TaskB, TaskC>;
+  using Variant1 = std::variant<TaskA, TaskB, TaskC, TaskD, TaskE>;
+
+  struct States {
+    std::vector<std::string> t_;
+  };
+
+  SECTION("an instance walks the tree like the dynamic engine") {
+    constexpr std::string_view s = "TaskC, TaskA($0)[TaskB(5)[TaskA, TaskB]] TaskA[TaskC]";
+    const auto tree              = compile_dynamic<Variant>(s);
+
+    States expected;
+    auto dynamic_tree     = tree;
+    size_t expected_steps = 1;
+    while (Execute::execute_step<Variant>(dynamic_tree, expected, std::make_tuple(-5)) == BUSY) expected_steps++;
+
+    States states;
+    Execute::TreeInstances<Variant, std::tuple<int32_t>> set(Execute::make_blueprint<Variant>(tree));
+    const uint32_t i = set.add({-5});
+    for (int32_t pass = 0; pass < 2; ++pass) {
+      states.t_.clear();
+      size_t steps = 1;
+      while (Execute::execute_instance_step(set, i, states) == BUSY) steps++;
+
+      REQUIRE(steps == expected_steps);
+      REQUIRE(states.t_ == expected.t_);
+    }
+  }
+
+  SECTION("instances share the blueprint and keep their own parameters") {
+    const auto blueprint = Execute::make_blueprint<Variant>(compile_dynamic<Variant>("TaskC($0)"));
+    States states;  // exit of the active tasks needs it when the set is destroyed
+    Execute::TreeInstances<Variant, std::tuple<int32_t>> set(blueprint);
+
+    set.add({1});
+    const uint32_t second = set.add({2});
+    set.add({3});
+    REQUIRE(blueprint.use_count() == 2);
+
+    // TaskC runs three times before it succeeds
+    Execute::execute_instances(set, states);
+    REQUIRE(states.t_ == std::vector<std::string>{"init [1]", "run [1]", "init [2]", "run [2]", "init [3]", "run [3]"});
+
+    // a removed instance ends its busy task with exit, the index is reused
+    set.remove(second);
+    REQUIRE(states.t_.back() == "exit [2]");
+    REQUIRE(set.size() == 2);
+    REQUIRE(set.add({4}) == second);
+
+    states.t_.clear();
+    size_t done = 0;
+    for (int32_t i = 0; i < 3; ++i) done += Execute::execute_instances(set, states);
+    REQUIRE(done == 2);
+    REQUIRE(states.t_.back() == "exit [3]");
+    REQUIRE(std::count(states.t_.begin(), states.t_.end(), "init [4]") == 1);
+  }
+
+  SECTION("destroyed while tasks are busy") {
+    States states;
+    {
+      Execute::TreeInstances<Variant, std::tuple<int32_t>> set(
+          Execute::make_blueprint<Variant>(compile_dynamic<Variant>("TaskC($0)")));
+      set.add({1});
+      set.add({2});
+      Execute::execute_instances(set, states);
+      states.t_.clear();
+    }
+    REQUIRE(states.t_ == std::vector<std::string>{"exit [1]", "exit [2]"});
+  }
+
+  SECTION("batched tasks") {
+    using Variant2 = std::variant<TaskA, TaskBatch>;
+    const auto blueprint =
+        Execute::make_blueprint<Variant2>(compile_dynamic<Variant2>("TaskBatch($0)[TaskA(1)], TaskA(2)"));
+    Execute::TreeInstances<Variant2, std::tuple<int32_t>> set(blueprint);
+    States states;
+
+    set.add({5});
+    set.add({-1});
+    set.add({3});
+
+    // all instances enter TaskBatch in the same step
+    REQUIRE(Execute::execute_instances(set, states) == 0);
+    REQUIRE(states.t_ == std::vector<std::string>{"batch [3]"});
+
+    // the failed one skipped the child
+    states.t_.clear();
+    REQUIRE(Execute::execute_instances(set, states) == 1);
+    REQUIRE(states.t_ == std::vector<std::string>{"init [1]", "run [1]", "exit [1]", "init [2]", "run [2]", "exit [2]",
+                                                  "init [1]", "run [1]", "exit [1]"});
+
+    // a single step evaluates a batch of one
+    states.t_.clear();
+    Execute::TreeInstances<Variant2, std::tuple<int32_t>> single(blueprint);
+    REQUIRE(Execute::execute_instance_step(single, single.add({1}), states) == BUSY);
+    REQUIRE(states.t_ == std::vector<std::string>{"batch [1]"});
+  }
+
+  SECTION("co-routines") {
+    StateProvider<Variant1> sp;
+    Execute::TreeInstances<Variant1, std::tuple<int32_t, int32_t>> set(
+        Execute::make_blueprint<Variant1>(compile_dynamic<Variant1>("TaskD($0)[TaskE($1)], TaskA($0)")));
+    const uint32_t i = set.add({10, 20});
+
+    State res        = BUSY;
+    for (int32_t f = 0; f < 100 && res == BUSY; ++f) {
+      res = Execute::execute_instance_step(set, i, sp);
+      TBT_EXECUTE_QUEUE(sp)
+    }
+
+    REQUIRE(res == SUCCESS);
+    REQUIRE(sp.t_.size() == 14);
+    REQUIRE(sp.t_[0] == "co_await start [10]");
+    REQUIRE(sp.t_[5] == "co_await end [10]");
+    REQUIRE(sp.t_[10] == "exit [20]");
+    REQUIRE(sp.t_[13] == "exit [10]");
+  }
+
+  SECTION("removed while awaiting a tree") {
+    FrameProvider<Variant1> sp;
+    Execute::TreeInstances<Variant1, std::tuple<int32_t, int32_t>> set(
+        Execute::make_blueprint<Variant1>(compile_dynamic<Variant1>("TaskD($0)[TaskE($1)]")));
+    const uint32_t i = set.add({10, 20});
+
+    // the coroutine is suspended on the queued tree and detaches from it when destroyed
+    Execute::execute_instance_step(set, i, sp);
+    Execute::execute_instance_step(set, i, sp);
+    REQUIRE(sp.tasks_queue_.size() == 1);
+    set.remove(i);
+    sp.frame_pool_.trim();
+
+    for (int32_t f = 0; f < 10; ++f) { TBT_EXECUTE_QUEUE(sp) }
+    REQUIRE(sp.tasks_queue_.empty());
+    REQUIRE(sp.t_.back() == "exit [50]");
+  }
+}
+
+TEST_CASE("static bindings", "[Execute]") {
+  using Variant = std::variant<TaskA, TaskB, TaskC>;
+
+  struct States {
+    std::vector<std::string> t_;
+  } states;
+
+  // static payload, dynamic payload and default construction. mismatching types don't compile
+  constexpr std::string_view s = "TaskA(7), TaskB($1), TaskA, TaskC($1, 2)";
+  constexpr auto tree          = compile_static<compute_size_static<Variant>(s), Variant>(s);
+
+  auto step                    = Execute::prepare_static<Variant, tree>(states, 1.5f, 8);
+  while (step() == BUSY) {}
+
+  REQUIRE(states.t_[0] == "init [7]");
+  REQUIRE(states.t_[3] == "init [8]");
+  REQUIRE(states.t_[6] == "init [1]");
+  REQUIRE(states.t_[9] == "init [8]");
+  // TaskC::it_ starts at 2 and runs only once
+  REQUIRE(states.t_.size() == 12);
+
+  // parameters beyond the last member are ignored by both engines
+  {
+    constexpr std::string_view e = "TaskA(3, 4, $0)";
+    constexpr auto extra         = compile_static<compute_size_static<Variant>(e), Variant>(e);
+    states.t_.clear();
+    auto a = Execute::prepare_static<Variant, extra>(states, 5);
+    while (a() == BUSY) {}
+    auto b = Execute::prepare_compiled<Variant, extra>(states, 5);
+    while (b() == BUSY) {}
+    REQUIRE(states.t_ ==
+            std::vector<std::string>{"init [3]", "run [3]", "exit [3]", "init [3]", "run [3]", "exit [3]"});
+  }
+}
+
+TEST_CASE("static co-routines", "[Execute]") {
+  using Variant1 = std::variant<TaskA, TaskB, TaskC, TaskD, TaskE>;
+
+  StateProvider<Variant1> sp;
+
+  auto p = TBT_RUN_STATIC(0, "TaskD($0)[TaskE($1)], TaskA($0)", sp, STEPWISE_1, 10, 20);
+
+  for (int32_t i = 0; i < 1000; ++i) { TBT_EXECUTE_QUEUE(sp) }
+
+  REQUIRE(sp.t_.size() == 14);
+  REQUIRE(sp.t_[0] == "co_await start [10]");
+  REQUIRE(sp.t_[4] == "exit [50]");
+  REQUIRE(sp.t_[5] == "co_await end [10]");
+  REQUIRE(sp.t_[6] == "exit [10]");
+  REQUIRE(sp.t_[7] == "co_yield [20]");
+  REQUIRE(sp.t_[10] == "exit [20]");
+  REQUIRE(sp.t_[11] == "init [10]");
+  REQUIRE(sp.t_[13] == "exit [10]");
+  REQUIRE(p.done());
+  REQUIRE(p.wait() == SUCCESS);
+}
+
+template <class T>
+struct CountingAllocator {
+  using value_type = T;
+  int32_t* live_;
+
+  explicit CountingAllocator(int32_t* _live) : live_(_live) {}
+  template <class U>
+  CountingAllocator(const CountingAllocator<U>& _other) : live_(_other.live_) {}
+
+  T* allocate(size_t _n) {
+    (*live_)++;
+    return std::allocator<T>().allocate(_n);
+  }
+  void deallocate(T* _p, size_t _n) {
+    (*live_)--;
+    std::allocator<T>().deallocate(_p, _n);
+  }
+  bool operator==(const CountingAllocator& _other) const { return live_ == _other.live_; }
+};
+
+TEST_CASE("InplaceFunction", "[utility]") {
+  SECTION("small callables are stored inline") {
+    int32_t calls                            = 0;
+    InplaceFunction<int32_t(int32_t), 64> f1 = [&calls](int32_t _v) {
+      calls++;
+      return _v * 2;
+    };
+    REQUIRE(f1.is_inline());
+    REQUIRE(f1(21) == 42);
+
+    auto f2 = std::move(f1);
+    REQUIRE(!f1);
+    REQUIRE(f2(1) == 2);
+    REQUIRE(calls == 2);
+  }
+
+  SECTION("large callables go through the allocator") {
+    int32_t live = 0;
+    {
+      std::array<uint8_t, 128> big{};
+      big[0] = 3;
+      InplaceFunction<int32_t(), 64, CountingAllocator<std::byte>> f1(
+          [big]() { return static_cast<int32_t>(big[0]); }, CountingAllocator<std::byte>(&live));
+      REQUIRE(!f1.is_inline());
+      REQUIRE(live == 1);
+
+      auto f2 = std::move(f1);
+      REQUIRE(f2() == 3);
+      REQUIRE(live == 1);
+    }
+    REQUIRE(live == 0);
+  }
+
+  SECTION("move-only captures are destroyed with the function") {
+    auto shared = std::make_shared<int32_t>(5);
+    InplaceFunction<int32_t()> f1 = [p = std::make_unique<std::shared_ptr<int32_t>>(shared)]() { return **p; };
+    REQUIRE(f1() == 5);
+    REQUIRE(shared.use_count() == 2);
+
+    f1 = nullptr;
+    REQUIRE(shared.use_count() == 1);
+  }
+}
+
+TEST_CASE("move-only parameters", "[Execute]") {
+  using Variant1 = std::variant<TaskA, TaskOwner>;
+
+  StateProvider<Variant1> sp;
+
+  // the argument is moved into the first node that binds it
+  auto p1 = TBT_RUN(0, "TaskOwner($0), TaskOwner($0)", sp, STEPWISE_1, std::make_unique<int32_t>(3));
+  auto p2 = TBT_RUN_STATIC(0, "TaskOwner($0), TaskOwner($0)", sp, STEPWISE_1, std::make_unique<int32_t>(4));
+  REQUIRE(p1.ref_->tree_.is_inline());
+
+  for (int32_t i = 0; i < 10; ++i) { TBT_EXECUTE_QUEUE(sp) }
+
+  REQUIRE(sp.t_ == std::vector<std::string>{"run [3]", "run [4]", "run [-1]", "run [-1]"});
+}
+
+TEST_CASE("parameter bindings", "[Execute]") {
+  using Variant1 = std::variant<TaskA, TaskTracked, TaskTrackedRef>;
+
+  StateProvider<Variant1> sp;
+  Tracked::copies_ = 0;
+
+  SECTION("by reference") {
+    constexpr std::string_view tree = "TaskTrackedRef(&$0), TaskTrackedRef(&$0), TaskTracked($0)";
+    TBT_RUN(0, tree, sp, STEPWISE_1, Tracked(1));
+    TBT_RUN_STATIC(0, tree, sp, STEPWISE_1, Tracked(2));
+
+    for (int32_t i = 0; i < 10; ++i) { TBT_EXECUTE_QUEUE(sp) }
+    REQUIRE(sp.t_ ==
+            std::vector<std::string>{"ref [1]", "ref [2]", "ref [1]", "ref [2]", "tracked [1]", "tracked [2]"});
+    // only the bindings by value copy
+    REQUIRE(Tracked::copies_ == 2);
+  }
+
+  SECTION("moved once") {
+    constexpr std::string_view tree = "TaskTracked($0&&), TaskTracked($0&&)";
+    TBT_RUN(0, tree, sp, STEPWISE_1, Tracked(3));
+    TBT_RUN_STATIC(0, tree, sp, STEPWISE_1, Tracked(4));
+
+    for (int32_t i = 0; i < 10; ++i) { TBT_EXECUTE_QUEUE(sp) }
+    REQUIRE(sp.t_ == std::vector<std::string>{"tracked [3]", "tracked [4]", "tracked [-1]", "tracked [-1]"});
+    REQUIRE(Tracked::copies_ == 0);
+  }
+
+  // every other binding is rejected, at compile time by the static engine and with a hard error by the dynamic one
+  SECTION("rejected bindings") {
+    using Args = std::tuple<Tracked, std::unique_ptr<int32_t>>;
+    static_assert(Execute::detail::can_bind_arg<0, Compiler::bind_copy, Tracked, Args>());
+    static_assert(Execute::detail::can_bind_arg<0, Compiler::bind_ref, const Tracked*, const Args>());
+    static_assert(Execute::detail::can_bind_arg<1, Compiler::bind_move, std::unique_ptr<int32_t>, Args>());
+
+    static_assert(!Execute::detail::can_bind_arg<0, Compiler::bind_copy, int32_t, Args>());
+    static_assert(!Execute::detail::can_bind_arg<0, Compiler::bind_copy, Tracked*, Args>());
+    static_assert(!Execute::detail::can_bind_arg<0, Compiler::bind_ref, Tracked, Args>());
+    static_assert(!Execute::detail::can_bind_arg<0, Compiler::bind_ref, Tracked*, const Args>());
+    static_assert(!Execute::detail::can_bind_arg<1, Compiler::bind_copy, std::unique_ptr<int32_t>, const Args>());
+  }
+}
+
+TEST_CASE("completion", "[Execute]") {
+  using Variant1 = std::variant<TaskA, TaskB, TaskC, TaskD, TaskE>;
+
+  StateProvider<Variant1> sp;
+
+  SECTION("handles see the result until they are released") {
+    auto p1 = TBT_RUN(0, "TaskC($0)", sp, STEPWISE_1, 10);
+    auto p2 = TBT_RUN(0, "TaskA($0)", sp, FULL_1, 20);
+    TBT_RUN(0, "TaskA($0)", sp, STEPWISE_1, 30);
+
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(!p1.done());
+    REQUIRE(p2.done());
+    REQUIRE(p2.await_ready());
+    REQUIRE(p2.await_resume() == SUCCESS);
+
+    // the item without a handle is gone, the finished one waits for its handle
+    REQUIRE(sp.tasks_queue_.size() == 2);
+    p2.release();
+
+    for (int32_t i = 0; i < 10; ++i) { TBT_EXECUTE_QUEUE(sp) }
+    REQUIRE(p1.done());
+    REQUIRE(p1.wait() == SUCCESS);
+    REQUIRE(sp.tasks_queue_.size() == 1);
+  }
+
+  SECTION("wait from another thread") {
+    auto p = TBT_RUN(0, "TaskC($0)", sp, STEPWISE_1, 10);
+
+    State res = BUSY;
+    std::thread waiter([&p, &res]() { res = p.wait(); });
+    while (!p.done()) { TBT_EXECUTE_QUEUE(sp) }
+    waiter.join();
+    REQUIRE(res == SUCCESS);
+  }
+}
+
+TEST_CASE("tree handles", "[Execute]") {
+  using Variant1 = std::variant<TaskA, TaskC>;
+
+  StateProvider<Variant1> sp;
+  auto& queue = sp.tasks_queue_;
+
+  SECTION("stale once the item is dropped") {
+    auto first              = TBT_RUN(0, "TaskA", sp, STEPWISE_1);
+    const TBT::TreeHandle h = first.handle();
+    first.release();
+    REQUIRE(queue.get(h) != nullptr);
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(queue.get(h) == nullptr);
+
+    // the slot is reused by the next tree, the old handle does not see it
+    auto p                  = TBT_RUN(0, "TaskC", sp, STEPWISE_1);
+    const TBT::TreeHandle n = p.handle();
+    REQUIRE(n.index_ == h.index_);
+    REQUIRE(n != h);
+    REQUIRE(queue.get(h) == nullptr);
+    REQUIRE(queue.get(n) == p.ref_);
+  }
+
+  SECTION("cancel through a handle") {
+    auto p                  = TBT_RUN(0, "TaskC", sp, STEPWISE_1);
+    const TBT::TreeHandle h = p.handle();
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(queue.cancel(h));
+    REQUIRE(p.await_resume() == CANCELLED);
+
+    p.release();
+    TBT_EXECUTE_QUEUE(sp)
+    REQUIRE(!queue.cancel(h));
+  }
+
+  SECTION("forged handles") {
+    TBT_RUN(0, "TaskC", sp, STEPWISE_1);
+    REQUIRE(queue.get(TBT::TreeHandle{}) == nullptr);
+    REQUIRE(queue.get(TBT::TreeHandle{.index_ = 1000, .generation_ = 1}) == nullptr);
+    REQUIRE(queue.get(TBT::TreeHandle{.index_ = 5, .generation_ = 0}) == nullptr);
+    REQUIRE(queue.get(TBT::TreeHandle{.index_ = 0, .generation_ = 2}) == nullptr);
+  }
+}
+
+TEST_CASE("submission from other threads", "[Execute]") {
+  using Variant1 = std::variant<TaskA>;
+
+  StateProvider<Variant1> sp;
+  constexpr int32_t producers  = 8;
+  constexpr int32_t per_thread = 50;
+
+  // the value of a tree encodes its producer and its position, ticket_of maps it to the ticket it got
+  std::vector<uint64_t> ticket_of(producers * per_thread);
+  const auto produce = [&](const int32_t _p) {
+    for (int32_t i = 0; i < per_thread; ++i) {
+      const int32_t v = _p * per_thread + i;
+      ticket_of[v]    = TBT_SUBMIT(0, "TaskA($0)", sp, STEPWISE_1, v);
+    }
+  };
+
+  // the inits of all trees that ran since the last call
+  const auto ran = [&sp]() {
+    std::vector<int32_t> out;
+    for (const std::string& s : sp.t_)
+      if (s.starts_with("init")) out.push_back(std::stoi(s.substr(6)));
+    sp.t_.clear();
+    return out;
+  };
+
+  SECTION("drained in ticket order") {
+    std::vector<std::thread> threads;
+    for (int32_t p = 0; p < producers; ++p) threads.emplace_back(produce, p);
+    for (std::thread& t : threads) t.join();
+    REQUIRE(sp.tasks_queue_.size() == 0);
+
+    TBT_EXECUTE_QUEUE(sp)
+    const std::vector<int32_t> values = ran();
+    REQUIRE(values.size() == size_t(producers * per_thread));
+    for (size_t i = 1; i < values.size(); ++i) REQUIRE(ticket_of[values[i - 1]] < ticket_of[values[i]]);
+    REQUIRE(sp.tasks_queue_.size() == 0);
+  }
+
+  SECTION("while the queue executes") {
+    std::atomic<bool> done = false;
+    std::vector<std::thread> threads;
+    for (int32_t p = 0; p < producers; ++p) threads.emplace_back(produce, p);
+    std::thread joiner([&]() {
+      for (std::thread& t : threads) t.join();
+      done = true;
+    });
+
+    size_t count = 0;
+    while (!done) {
+      TBT_EXECUTE_QUEUE(sp)
+      count += ran().size();
+    }
+    joiner.join();
+    TBT_EXECUTE_QUEUE(sp)
+    count += ran().size();
+    REQUIRE(count == size_t(producers * per_thread));
+  }
+}
+
+TEST_CASE("queue priorities", "[Execute]") {
+  using Variant1 = std::variant<TaskA, TaskB, TaskC, TaskD, TaskE>;
+
+  StateProvider<Variant1> sp;
+
+  // higher priorities first, submission order within a priority
+  TBT_RUN(0, "TaskA($0)", sp, STEPWISE_1, 1);
+  TBT_RUN(5, "TaskA($0)", sp, STEPWISE_1, 2);
+  TBT_RUN(0, "TaskA($0)", sp, STEPWISE_1, 3);
+  TBT_RUN(-2, "TaskA($0)", sp, STEPWISE_1, 4);
+  TBT_RUN(5, "TaskA($0)", sp, STEPWISE_1, 5);
+  REQUIRE(sp.tasks_queue_.size() == 5);
+
+  TBT_EXECUTE_QUEUE(sp)
+  REQUIRE(sp.t_ == std::vector<std::string>{"init [2]", "run [2]", "exit [2]", "init [5]", "run [5]", "exit [5]",
+                                            "init [1]", "run [1]", "exit [1]", "init [3]", "run [3]", "exit [3]",
+                                            "init [4]", "run [4]", "exit [4]"});
+  REQUIRE(sp.tasks_queue_.empty());
+
+  // freed items are reused, handles keep pointing at their own item
+  auto p1 = TBT_RUN(1, "TaskC($0)", sp, STEPWISE_1, 10);
+  auto p2 = TBT_RUN(1, "TaskA($0)", sp, STEPWISE_1, 20);
+  for (int32_t i = 0; i < 100; ++i) TBT_RUN(0, "TaskA($0)", sp, STEPWISE_1, i);
+  for (int32_t i = 0; i < 10; ++i) { TBT_EXECUTE_QUEUE(sp) }
+  REQUIRE(p1.done());
+  REQUIRE(p2.done());
+  REQUIRE(sp.tasks_queue_.size() == 2);
+}
+
+template <class Variant_>
+struct ParallelProvider {
+  using Variant = Variant_;
+
+  explicit ParallelProvider(const uint32_t _workers) : counts_(_workers) {}
+
+  TBT::WorkerLocal<int32_t> counts_;
+  std::atomic<int32_t> misplaced_ = 0;
+  TBT::TaskQueue<> tasks_queue_;
+};
+
+TEST_CASE("parallel queue", "[Execute]") {
+  using Variant1 = std::variant<TaskCount, TaskSpawn>;
+
+  TBT::WorkerPool pool(4);
+  ParallelProvider<Variant1> sp(pool.size());
+  REQUIRE(pool.size() == 4);
+
+  auto p = TBT_RUN(0, "TaskCount(3), TaskCount(2)", sp, STEPWISE_1);
+  for (int32_t i = 0; i < 200; ++i) TBT_RUN(i % 3, "TaskCount(3)[TaskCount(2)]", sp, STEPWISE_1);
+  for (int32_t i = 0; i < 20; ++i) TBT_RUN_MAIN_THREAD(1, "TaskCount(4, true)", sp, STEPWISE_1);
+  for (int32_t i = 0; i < 10; ++i) TBT_RUN(2, "TaskSpawn", sp, FULL_1);
+
+  for (int32_t i = 0; i < 100 && sp.tasks_queue_.size() > 1; ++i) { TBT_EXECUTE_QUEUE_PARALLEL(sp, pool) }
+
+  REQUIRE(p.done());
+  REQUIRE(p.wait() == SUCCESS);
+  REQUIRE(sp.tasks_queue_.size() == 1);
+  REQUIRE(sp.misplaced_ == 0);
+
+  int32_t runs = 0;
+  for (uint32_t w = 0; w < sp.counts_.size(); ++w) runs += sp.counts_[w];
+  REQUIRE(runs == 5 + 200 * 5 + 20 * 4 + 10 * 2);
 }
\ No newline at end of file